@@ -79,9 +79,12 @@ static void NotifyOwnerOfChanges(std::wstring& oldTitle, std::wstring& oldEnviro
         {
             oldEnvironment.assign(env, len);
 
+            // After the owner has the whole environment, it only needs to know what changed
             Json::Dict message = Json::CreateMessage(PIPE_COMMAND_STATE_CHANGED);
-            message.Set(PIPE_PROPERTY_ENVIRONMENT, Json::Value(Json::ParseNameValuePairs(env, '\0')));
-            ::SendToOwner(message);
+            if (DevInject::AddEnvironment(message, env, true))
+            {
+                ::SendToOwner(message);
+            }
         }
 
         ::FreeEnvironmentStrings(env);
@@ -129,7 +132,7 @@ static unsigned int __stdcall FindMainWindowThread(void*)
     if (hwnd)
     {
         Json::Dict message = Json::CreateMessage(PIPE_COMMAND_WINDOW_CREATED);
-        message.Set(PIPE_PROPERTY_HWND, Json::Value(std::to_wstring(reinterpret_cast<size_t>(hwnd))));
+        message.Set(PIPE_PROPERTY_HWND, Json::Value(hwnd));
         ::SendToOwner(message);
     }
 
@@ -1,6 +1,8 @@
 ﻿#include "stdafx.h"
 #include "Context/AppMessageHandler.h"
+#include "Json/Patch.h"
 #include "Json/Persist.h"
+#include "Json/State.h"
 #include "Main.h"
 #include "Utility.h"
 
@@ -15,13 +17,17 @@ static Json::Value HandleGetDirectory()
     return Json::Value();
 }
 
-static Json::Value HandleGetEnvironment()
+// The last environment sent to the owner. Every change gets a new version and a patch
+// always goes from the version before it, so the owner can tell when it's out of order or missed one.
+static std::mutex environmentMutex;
+static Json::Dict environmentSent;
+static int environmentVersion = 0;
+
+static void HandleGetEnvironment(Json::Dict& dict)
 {
     wchar_t* env = ::GetEnvironmentStrings();
-    Json::Value result = Json::Value(Json::ParseNameValuePairs(env, '\0'));;
+    DevInject::AddEnvironment(dict, env, false);
     ::FreeEnvironmentStrings(env);
-
-    return result;
 }
 
 static Json::Value HandleGetExecutable()
@@ -48,7 +54,7 @@ static void HandleSetTitle(const Json::Value& value)
 {
     if (value.IsString())
     {
-        ::SetConsoleTitle(value.GetString().c_str());
+        ::SetConsoleTitle(value.TryGetString().c_str());
     }
 }
 
@@ -91,14 +97,14 @@ static void HandleSetAliases(const Json::Value& value)
     {
         if (i.second.IsDict())
         {
-            const std::wstring& exeName = i.first;
+            const std::pmr::wstring& exeName = i.first;
 
             for (const auto& h : i.second.GetDict())
             {
                 if (h.second.IsString())
                 {
-                    const std::wstring& aliasName = h.first;
-                    const std::wstring& aliasValue = h.second.GetString();
+                    const std::pmr::wstring& aliasName = h.first;
+                    std::wstring aliasValue = h.second.TryGetString();
 
                     ::AddConsoleAlias(
                         const_cast<wchar_t*>(aliasName.c_str()),
@@ -112,23 +118,20 @@ static void HandleSetAliases(const Json::Value& value)
 
 static Json::Value HandleGetColors()
 {
-    Json::Dict dict;
-
     HANDLE handle = ::GetStdHandle(STD_OUTPUT_HANDLE);
     CONSOLE_SCREEN_BUFFER_INFOEX info;
     info.cbSize = sizeof(info);
 
     if (::GetConsoleScreenBufferInfoEx(handle, &info))
     {
-        dict.Set(L"indexes", Json::Value(std::to_wstring(info.wAttributes & 0xFF)));
+        Json::ConsoleColors colors{};
+        colors.indexes = info.wAttributes & 0xFF;
+        std::copy(std::begin(info.ColorTable), std::end(info.ColorTable), colors.table.begin());
 
-        for (size_t i = 0; i < _countof(info.ColorTable); i++)
-        {
-            dict.Set(std::to_wstring(i), Json::Value(std::to_wstring(info.ColorTable[i])));
-        }
+        return Json::Value(Json::ToDict(colors));
     }
 
-    return Json::Value(std::move(dict));
+    return Json::Value(Json::Dict());
 }
 
 static void HandleSetColors(const Json::Value& value)
@@ -144,26 +147,20 @@ static void HandleSetColors(const Json::Value& value)
 
     if (::GetConsoleScreenBufferInfoEx(handle, &info))
     {
-        Json::Value indexes = value.GetDict().Get(L"indexes");
-        if (indexes.IsString())
+        // Zero means the value was missing, so the current one is kept
+        Json::ConsoleColors colors{};
+        Json::Read(value.GetDict(), colors);
+
+        if (colors.indexes)
         {
-            unsigned long value = std::wcstoul(indexes.GetString().c_str(), nullptr, 10);
-            if (value)
-            {
-                info.wAttributes = (info.wAttributes & 0xFF00) | static_cast<WORD>(value & 0xFF);
-            }
+            info.wAttributes = (info.wAttributes & 0xFF00) | static_cast<WORD>(colors.indexes & 0xFF);
         }
 
-        for (size_t i = 0; i < _countof(info.ColorTable); i++)
+        for (size_t i = 0; i < colors.table.size(); i++)
         {
-            Json::Value color = value.GetDict().Get(std::to_wstring(i));
-            if (color.IsString())
+            if (colors.table[i])
             {
-                unsigned long value = std::wcstoul(color.GetString().c_str(), nullptr, 10);
-                if (value)
-                {
-                    info.ColorTable[i] = value;
-                }
+                info.ColorTable[i] = colors.table[i];
             }
         }
 
@@ -178,7 +175,7 @@ static Json::Dict HandleGetState(const Json::Dict& input)
     dict.Set(PIPE_PROPERTY_ALIASES, ::HandleGetAliases());
     dict.Set(PIPE_PROPERTY_COLORS, ::HandleGetColors());
     dict.Set(PIPE_PROPERTY_DIRECTORY, ::HandleGetDirectory());
-    dict.Set(PIPE_PROPERTY_ENVIRONMENT, ::HandleGetEnvironment());
+    ::HandleGetEnvironment(dict);
     dict.Set(PIPE_PROPERTY_EXECUTABLE, ::HandleGetExecutable());
     dict.Set(PIPE_PROPERTY_TITLE, ::HandleGetTitle());
 
@@ -242,6 +239,37 @@ static Json::Dict HandleDetach(const Json::Dict& input)
     return Json::Dict();
 }
 
+// Sets the whole environment in a message for the owner, or only a patch when the owner already got an older version
+bool DevInject::AddEnvironment(Json::Dict& message, const wchar_t* env, bool onlyChanges)
+{
+    Json::Dict environment = Json::ParseNameValuePairs(env, '\0');
+
+    std::scoped_lock<std::mutex> lock(::environmentMutex);
+    bool changed = !(environment == ::environmentSent);
+    if (!changed && onlyChanges)
+    {
+        return false;
+    }
+
+    if (changed && onlyChanges && ::environmentVersion)
+    {
+        message.Set(Json::Keys::EnvironmentPatch, Json::Value(Json::Diff(::environmentSent, environment)));
+    }
+    else
+    {
+        message.Set(Json::Keys::Environment, Json::Value(Json::Dict(environment)));
+    }
+
+    if (changed)
+    {
+        ::environmentVersion++;
+        ::environmentSent = std::move(environment);
+    }
+
+    message.Set(Json::Keys::EnvironmentVersion, Json::Value(::environmentVersion));
+    return true;
+}
+
 // Handles commands comming in from the owner app
 Json::MessageHandler DevInject::CreateMessageHandler()
 {
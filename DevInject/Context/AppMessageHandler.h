@@ -5,4 +5,5 @@
 namespace DevInject
 {
     Json::MessageHandler CreateMessageHandler();
+    bool AddEnvironment(Json::Dict& message, const wchar_t* env, bool onlyChanges);
 }
@@ -209,7 +209,7 @@ static unsigned int __stdcall InitializeThread(void*)
 {
     ::SendToOwner(Json::CreateMessage(PIPE_COMMAND_CONHOST_INJECTED), [](const Json::Dict& dict)
     {
-        HWND hwnd = dict.Get(PIPE_PROPERTY_HWND).TryGetHwndFromString();
+        HWND hwnd = dict.Get(PIPE_PROPERTY_HWND).TryGetHwnd();
         HWND hwndParent = hwnd ? ::GetParent(hwnd) : nullptr;
 
         if (hwndParent)
@@ -0,0 +1,68 @@
+﻿#include "stdafx.h"
+#include "Json/Arena.h"
+
+// A reset arena doesn't hold on to a first block bigger than this, one huge message shouldn't pin memory
+static const size_t MAX_RESET_SIZE = 1024 * 1024;
+
+Json::Arena::Upstream::Upstream()
+    : allocated(0)
+{
+}
+
+void* Json::Arena::Upstream::do_allocate(size_t bytes, size_t alignment)
+{
+    this->allocated += bytes;
+    return std::pmr::get_default_resource()->allocate(bytes, alignment);
+}
+
+void Json::Arena::Upstream::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+    std::pmr::get_default_resource()->deallocate(p, bytes, alignment);
+}
+
+bool Json::Arena::Upstream::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+Json::Arena::Arena(size_t initialSize)
+    : initialSize(std::max<size_t>(initialSize, 1024))
+    , initialBlock(new BYTE[this->initialSize])
+    , resource(this->initialBlock.get(), this->initialSize, &this->upstream)
+{
+}
+
+std::pmr::memory_resource* Json::Arena::GetResource()
+{
+    return &this->resource;
+}
+
+// Null terminated, just like strings that are owned by a std::wstring
+wchar_t* Json::Arena::AllocateString(size_t len)
+{
+    wchar_t* str = static_cast<wchar_t*>(this->resource.allocate((len + 1) * sizeof(wchar_t), alignof(wchar_t)));
+    str[len] = L'\0';
+    return str;
+}
+
+void Json::Arena::KeepAlive(std::shared_ptr<const void> owner)
+{
+    this->owner = std::move(owner);
+}
+
+// The resource can't be pointed at a new buffer, so it's made again in the same place
+void Json::Arena::Reset()
+{
+    this->owner.reset();
+    this->resource.release();
+
+    if (this->upstream.allocated && this->initialSize < ::MAX_RESET_SIZE)
+    {
+        this->resource.~monotonic_buffer_resource();
+        this->initialSize = std::min<size_t>(this->initialSize + this->upstream.allocated, ::MAX_RESET_SIZE);
+        this->initialBlock.reset(new BYTE[this->initialSize]);
+        new (&this->resource) std::pmr::monotonic_buffer_resource(this->initialBlock.get(), this->initialSize, &this->upstream);
+    }
+
+    this->upstream.allocated = 0;
+}
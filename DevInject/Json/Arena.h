@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include "Api.h"
+
+namespace Json
+{
+    // Monotonic memory for one parsed message. Nothing is freed until the arena itself goes away,
+    // which happens when the last node allocated from it is released, or until it's Reset() for another message.
+    class Arena
+    {
+    public:
+        DEV_INJECT_API Arena(size_t initialSize);
+
+        DEV_INJECT_API std::pmr::memory_resource* GetResource();
+        DEV_INJECT_API wchar_t* AllocateString(size_t len);
+
+        // Other memory that strings can point into, like a mapped file, stays alive with the arena
+        DEV_INJECT_API void KeepAlive(std::shared_ptr<const void> owner);
+
+        // Only when nothing allocated from the arena is still in use. The first block is kept,
+        // and it grows to fit the last message when that one needed more blocks.
+        DEV_INJECT_API void Reset();
+
+    private:
+        // Counts the blocks that didn't fit in the first one
+        class Upstream : public std::pmr::memory_resource
+        {
+        public:
+            Upstream();
+
+            size_t allocated;
+
+        private:
+            void* do_allocate(size_t bytes, size_t alignment) override;
+            void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+        };
+
+        size_t initialSize;
+        std::unique_ptr<BYTE[]> initialBlock;
+        Upstream upstream;
+        std::pmr::monotonic_buffer_resource resource;
+        std::shared_ptr<const void> owner;
+    };
+
+    // Allocator for shared nodes that keeps the arena alive for as long as the node
+    template<class T>
+    class ArenaAllocator
+    {
+    public:
+        typedef T value_type;
+
+        ArenaAllocator(const std::shared_ptr<Arena>& arena)
+            : arena(arena)
+        {
+        }
+
+        template<class T2>
+        ArenaAllocator(const ArenaAllocator<T2>& rhs)
+            : arena(rhs.arena)
+        {
+        }
+
+        T* allocate(size_t count)
+        {
+            return static_cast<T*>(this->arena->GetResource()->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* data, size_t count)
+        {
+            // Monotonic, the memory is reclaimed when the arena is destroyed
+        }
+
+        template<class T2>
+        bool operator==(const ArenaAllocator<T2>& rhs) const
+        {
+            return this->arena == rhs.arena;
+        }
+
+        template<class T2>
+        bool operator!=(const ArenaAllocator<T2>& rhs) const
+        {
+            return this->arena != rhs.arena;
+        }
+
+    private:
+        template<class T2> friend class ArenaAllocator;
+
+        std::shared_ptr<Arena> arena;
+    };
+
+    // Creates a shared node in the arena, or on the heap when there is no arena
+    template<class T, class... Args>
+    std::shared_ptr<T> MakeShared(const std::shared_ptr<Arena>& arena, Args&&... args)
+    {
+        return arena
+            ? std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...)
+            : std::make_shared<T>(std::forward<Args>(args)...);
+    }
+}
@@ -0,0 +1,648 @@
+﻿#include "stdafx.h"
+#include "Json/Binary.h"
+#include "Json/Utf8.h"
+
+// 0xFE never starts UTF-8 or UTF-16 JSON text. The last byte is the string format, 8 for UTF-8.
+// Older messages had the wchar_t size there and aren't read.
+static const BYTE BINARY_MAGIC[4] = { 0xFE, 'J', 'B', 8 };
+
+// Header: magic, total size, root slot
+static const size_t HEADER_SIZE = 16;
+static const size_t ROOT_SLOT_OFFSET = 8;
+
+// Slot: type, then the value or the offset of its record
+static const size_t SLOT_SIZE = 8;
+
+// Vector and dict records start with the item count. Dict entries are hash, key offset, value slot,
+// then a table of entry indexes sorted by hash follows the entries.
+static const size_t RECORD_HEADER_SIZE = 8;
+static const size_t ENTRY_SIZE = 16;
+
+namespace Json
+{
+    static unsigned int ReadUInt(const BYTE* pos);
+    static void StoreUInt(std::vector<BYTE>& buffer, size_t offset, size_t value);
+    static unsigned int HashBinaryKey(std::wstring_view key);
+    static bool KeyEquals(std::string_view utf8, std::wstring_view key);
+}
+
+// Records are aligned, but the buffer could be anything that was received
+unsigned int Json::ReadUInt(const BYTE* pos)
+{
+    unsigned int value;
+    std::memcpy(&value, pos, sizeof(value));
+    return value;
+}
+
+void Json::StoreUInt(std::vector<BYTE>& buffer, size_t offset, size_t value)
+{
+    assert(value <= UINT_MAX);
+    unsigned int value32 = static_cast<unsigned int>(value);
+    std::memcpy(buffer.data() + offset, &value32, sizeof(value32));
+}
+
+// Fixed at 32 bits so that 32 and 64-bit processes agree
+unsigned int Json::HashBinaryKey(std::wstring_view key)
+{
+    unsigned int hash = 2166136261;
+    for (wchar_t ch : key)
+    {
+        hash ^= static_cast<unsigned int>(ch);
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+// Keys are nearly always ASCII, those are compared without transcoding
+bool Json::KeyEquals(std::string_view utf8, std::wstring_view key)
+{
+    size_t i = 0;
+    for (; i < key.size() && i < utf8.size() && key[i] < 0x80; i++)
+    {
+        if (static_cast<unsigned char>(utf8[i]) != key[i])
+        {
+            return false;
+        }
+    }
+
+    if (i == key.size() || i == utf8.size())
+    {
+        return i == key.size() && i == utf8.size();
+    }
+
+    return Json::ToUtf8(key.substr(i)) == utf8.substr(i);
+}
+
+Json::BinaryValue::BinaryValue()
+    : data(nullptr)
+    , size(0)
+    , type(BinaryType::Unset)
+    , payload(0)
+{
+}
+
+// Records must come after the record that points to them, so a bad message can't loop
+Json::BinaryValue::BinaryValue(const BYTE* data, size_t size, const BYTE* slot, size_t parentOffset)
+    : data(data)
+    , size(size)
+    , type(static_cast<BinaryType>(Json::ReadUInt(slot)))
+    , payload(Json::ReadUInt(slot + 4))
+{
+    switch (this->type)
+    {
+    case BinaryType::Null:
+    case BinaryType::Bool:
+    case BinaryType::Int:
+        break;
+
+    case BinaryType::Int64:
+    case BinaryType::UInt64:
+    case BinaryType::Double:
+    case BinaryType::String:
+    case BinaryType::Vector:
+    case BinaryType::Dict:
+        if (this->payload <= parentOffset || this->payload >= size)
+        {
+            this->type = BinaryType::Unset;
+        }
+        break;
+
+    default:
+        this->type = BinaryType::Unset;
+        break;
+    }
+}
+
+bool Json::BinaryValue::IsBinary(const void* data, size_t size)
+{
+    return data && size >= ::HEADER_SIZE && std::equal(std::begin(::BINARY_MAGIC), std::end(::BINARY_MAGIC), static_cast<const BYTE*>(data));
+}
+
+Json::BinaryValue Json::BinaryValue::GetRoot(const void* data, size_t size)
+{
+    if (!BinaryValue::IsBinary(data, size))
+    {
+        return BinaryValue();
+    }
+
+    const BYTE* bytes = static_cast<const BYTE*>(data);
+    size = std::min<size_t>(size, Json::ReadUInt(bytes + 4));
+
+    BinaryValue root(bytes, size, bytes + ::ROOT_SLOT_OFFSET, 0);
+    return (root.type == BinaryType::Dict) ? root : BinaryValue();
+}
+
+Json::BinaryType Json::BinaryValue::GetType() const
+{
+    return this->type;
+}
+
+bool Json::BinaryValue::IsUnset() const
+{
+    return this->type == BinaryType::Unset;
+}
+
+bool Json::BinaryValue::GetBool() const
+{
+    return this->type == BinaryType::Bool && this->payload != 0;
+}
+
+int Json::BinaryValue::GetInt() const
+{
+    switch (this->type)
+    {
+    case BinaryType::Int:
+        return static_cast<int>(this->payload);
+
+    case BinaryType::Int64:
+    case BinaryType::UInt64:
+    case BinaryType::Double:
+        return static_cast<int>(this->GetInt64());
+
+    default:
+        return 0;
+    }
+}
+
+long long Json::BinaryValue::GetInt64() const
+{
+    switch (this->type)
+    {
+    case BinaryType::Int:
+        return static_cast<int>(this->payload);
+
+    case BinaryType::Int64:
+    case BinaryType::UInt64:
+        if (const BYTE* record = this->GetRecord(sizeof(long long), 0, sizeof(long long)))
+        {
+            long long value;
+            std::memcpy(&value, record, sizeof(value));
+            return value;
+        }
+        return 0;
+
+    case BinaryType::Double:
+        return static_cast<long long>(this->GetDouble());
+
+    default:
+        return 0;
+    }
+}
+
+unsigned long long Json::BinaryValue::GetUInt64() const
+{
+    return (this->type == BinaryType::Double) ? static_cast<unsigned long long>(this->GetDouble()) : static_cast<unsigned long long>(this->GetInt64());
+}
+
+double Json::BinaryValue::GetDouble() const
+{
+    switch (this->type)
+    {
+    case BinaryType::Int:
+    case BinaryType::Int64:
+        return static_cast<double>(this->GetInt64());
+
+    case BinaryType::UInt64:
+        return static_cast<double>(this->GetUInt64());
+
+    case BinaryType::Double:
+        if (const BYTE* record = this->GetRecord(sizeof(double), 0, sizeof(double)))
+        {
+            double value;
+            std::memcpy(&value, record, sizeof(value));
+            return value;
+        }
+        return 0.0;
+
+    default:
+        return 0.0;
+    }
+}
+
+std::string_view Json::BinaryValue::GetUtf8() const
+{
+    return (this->type == BinaryType::String) ? this->GetStringAt(this->payload, 0) : std::string_view();
+}
+
+std::wstring Json::BinaryValue::GetString() const
+{
+    return Json::ToUtf16(this->GetUtf8());
+}
+
+size_t Json::BinaryValue::Size() const
+{
+    const BYTE* record = nullptr;
+
+    if (this->type == BinaryType::Vector)
+    {
+        record = this->GetRecord(::RECORD_HEADER_SIZE, ::SLOT_SIZE, sizeof(unsigned int));
+    }
+    else if (this->type == BinaryType::Dict)
+    {
+        record = this->GetRecord(::RECORD_HEADER_SIZE, ::ENTRY_SIZE + sizeof(unsigned int), sizeof(unsigned int));
+    }
+
+    return record ? Json::ReadUInt(record) : 0;
+}
+
+Json::BinaryValue Json::BinaryValue::GetAt(size_t index) const
+{
+    return (index < this->Size()) ? this->GetEntryValue(this->data + this->payload, index) : BinaryValue();
+}
+
+std::string_view Json::BinaryValue::GetKeyAt(size_t index) const
+{
+    if (this->type != BinaryType::Dict || index >= this->Size())
+    {
+        return std::string_view();
+    }
+
+    const BYTE* entry = this->data + this->payload + ::RECORD_HEADER_SIZE + index * ::ENTRY_SIZE;
+    return this->GetStringAt(Json::ReadUInt(entry + 4), this->payload);
+}
+
+// Binary search through the sorted hash table, then compare keys with the same hash
+Json::BinaryValue Json::BinaryValue::Get(std::wstring_view key) const
+{
+    size_t count = (this->type == BinaryType::Dict) ? this->Size() : 0;
+    if (!count)
+    {
+        return BinaryValue();
+    }
+
+    const BYTE* record = this->data + this->payload;
+    const BYTE* entries = record + ::RECORD_HEADER_SIZE;
+    const BYTE* sorted = entries + count * ::ENTRY_SIZE;
+    unsigned int hash = Json::HashBinaryKey(key);
+
+    auto getHash = [count, entries, sorted](size_t i)
+    {
+        size_t entry = Json::ReadUInt(sorted + i * sizeof(unsigned int));
+        return (entry < count) ? Json::ReadUInt(entries + entry * ::ENTRY_SIZE) : 0;
+    };
+
+    size_t low = 0;
+    for (size_t high = count; low < high; )
+    {
+        size_t mid = low + (high - low) / 2;
+        if (getHash(mid) < hash)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    for (; low < count && getHash(low) == hash; low++)
+    {
+        size_t entry = Json::ReadUInt(sorted + low * sizeof(unsigned int));
+        if (entry < count && Json::KeyEquals(this->GetKeyAt(entry), key))
+        {
+            return this->GetEntryValue(record, entry);
+        }
+    }
+
+    return BinaryValue();
+}
+
+// Every value written takes at least one slot. Records that are pointed to more than once
+// could still blow up into a huge tree, so stop after that many values.
+Json::Value Json::BinaryValue::ToValue(const std::shared_ptr<Arena>& arena) const
+{
+    size_t budget = this->size / ::SLOT_SIZE;
+    return this->ToValue(arena, budget);
+}
+
+Json::Value Json::BinaryValue::ToValue(const std::shared_ptr<Arena>& arena, size_t& budget) const
+{
+    if (!budget)
+    {
+        return Value();
+    }
+
+    budget--;
+
+    switch (this->type)
+    {
+    case BinaryType::Null:
+        return Value(nullptr);
+
+    case BinaryType::Bool:
+        return Value(this->GetBool());
+
+    case BinaryType::Int:
+        return Value(this->GetInt());
+
+    case BinaryType::Int64:
+        return Value(this->GetInt64());
+
+    case BinaryType::UInt64:
+        return Value(this->GetUInt64());
+
+    case BinaryType::Double:
+        return Value(this->GetDouble());
+
+    case BinaryType::String:
+        {
+            // Each UTF-8 byte makes at most one UTF-16 char
+            std::string_view value = this->GetUtf8();
+            if (value.size() <= Value::SHORT_STRING_SIZE)
+            {
+                wchar_t chars[Value::SHORT_STRING_SIZE];
+                return Value(std::wstring_view(chars, Json::Utf8ToUtf16(value.data(), value.size(), chars)));
+            }
+
+            if (arena)
+            {
+                wchar_t* chars = arena->AllocateString(value.size());
+                size_t length = Json::Utf8ToUtf16(value.data(), value.size(), chars);
+                chars[length] = L'\0';
+                return Value(std::shared_ptr<const wchar_t>(arena, chars), length);
+            }
+
+            return Value(Json::ToUtf16(value));
+        }
+
+    case BinaryType::Vector:
+        {
+            size_t count = this->Size();
+            std::shared_ptr<std::pmr::vector<Value>> values = Json::MakeShared<std::pmr::vector<Value>>(arena, arena ? arena->GetResource() : std::pmr::get_default_resource());
+            values->reserve(count);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                values->push_back(this->GetAt(i).ToValue(arena, budget));
+            }
+
+            return Value(std::move(values));
+        }
+
+    case BinaryType::Dict:
+        {
+            size_t count = this->Size();
+            std::shared_ptr<Dict> dict = Json::MakeShared<Dict>(arena, arena);
+
+            // Keys are transcoded on the stack unless they're long, Set copies them anyway
+            wchar_t shortKey[64];
+            std::wstring longKey;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                std::string_view utf8Key = this->GetKeyAt(i);
+                wchar_t* keyChars = shortKey;
+
+                if (utf8Key.size() > _countof(shortKey))
+                {
+                    longKey.resize(utf8Key.size());
+                    keyChars = &longKey[0];
+                }
+
+                size_t keyLength = Json::Utf8ToUtf16(utf8Key.data(), utf8Key.size(), keyChars);
+                dict->Set(std::wstring_view(keyChars, keyLength), this->GetAt(i).ToValue(arena, budget));
+            }
+
+            return Value(std::move(dict));
+        }
+
+    default:
+        return Value();
+    }
+}
+
+// Checks that the record and its items fit in the buffer, the count is always first
+const BYTE* Json::BinaryValue::GetRecord(size_t headerSize, size_t itemSize, size_t align) const
+{
+    size_t offset = this->payload;
+    if (offset % align || headerSize > this->size - offset)
+    {
+        return nullptr;
+    }
+
+    const BYTE* record = this->data + offset;
+    unsigned long long itemsSize = itemSize ? static_cast<unsigned long long>(Json::ReadUInt(record)) * itemSize : 0;
+    return (itemsSize <= this->size - offset - headerSize) ? record : nullptr;
+}
+
+Json::BinaryValue Json::BinaryValue::GetEntryValue(const BYTE* record, size_t index) const
+{
+    const BYTE* slot = (this->type == BinaryType::Dict)
+        ? record + ::RECORD_HEADER_SIZE + index * ::ENTRY_SIZE + 8
+        : record + ::RECORD_HEADER_SIZE + index * ::SLOT_SIZE;
+
+    return BinaryValue(this->data, this->size, slot, this->payload);
+}
+
+// Length in bytes, then the UTF-8 with a null terminator
+std::string_view Json::BinaryValue::GetStringAt(size_t offset, size_t parentOffset) const
+{
+    if (offset <= parentOffset || offset % sizeof(unsigned int) || offset >= this->size || sizeof(unsigned int) > this->size - offset)
+    {
+        return std::string_view();
+    }
+
+    unsigned long long length = Json::ReadUInt(this->data + offset);
+    if (length + 1 > this->size - offset - sizeof(unsigned int))
+    {
+        return std::string_view();
+    }
+
+    return std::string_view(reinterpret_cast<const char*>(this->data + offset + sizeof(unsigned int)), static_cast<size_t>(length));
+}
+
+Json::BinaryWriter::BinaryWriter()
+{
+}
+
+void Json::BinaryWriter::Clear()
+{
+    this->buffer.clear();
+}
+
+// Replaces whatever was written before, one buffer holds one message
+void Json::BinaryWriter::Write(const Dict& dict)
+{
+    this->buffer.clear();
+    this->Reserve(::HEADER_SIZE, sizeof(unsigned long long));
+    std::copy(std::begin(::BINARY_MAGIC), std::end(::BINARY_MAGIC), this->buffer.begin());
+
+    this->StoreSlot(::ROOT_SLOT_OFFSET, BinaryType::Dict, this->WriteDict(dict));
+    Json::StoreUInt(this->buffer, 4, this->buffer.size());
+}
+
+const BYTE* Json::BinaryWriter::GetData() const
+{
+    return this->buffer.data();
+}
+
+size_t Json::BinaryWriter::GetSize() const
+{
+    return this->buffer.size();
+}
+
+// The root record is always the first thing after the header
+size_t Json::BinaryWriter::GetRootIntOffset(size_t index)
+{
+    return ::HEADER_SIZE + ::RECORD_HEADER_SIZE + index * ::ENTRY_SIZE + 8 + 4;
+}
+
+void Json::BinaryWriter::WriteValue(const Value& value, size_t slotOffset)
+{
+    if (value.IsBool())
+    {
+        this->StoreSlot(slotOffset, BinaryType::Bool, value.GetBool() ? 1 : 0);
+    }
+    else if (value.IsInt())
+    {
+        this->StoreSlot(slotOffset, BinaryType::Int, static_cast<unsigned int>(value.GetInt()));
+    }
+    else if (value.IsNumber())
+    {
+        BinaryType type = value.IsInt64() ? BinaryType::Int64 : (value.IsUInt64() ? BinaryType::UInt64 : BinaryType::Double);
+        size_t offset = this->Reserve(sizeof(unsigned long long), sizeof(unsigned long long));
+
+        if (type == BinaryType::Double)
+        {
+            double number = value.GetDouble();
+            std::memcpy(this->buffer.data() + offset, &number, sizeof(number));
+        }
+        else
+        {
+            unsigned long long number = (type == BinaryType::Int64) ? static_cast<unsigned long long>(value.GetInt64()) : value.GetUInt64();
+            std::memcpy(this->buffer.data() + offset, &number, sizeof(number));
+        }
+
+        this->StoreSlot(slotOffset, type, offset);
+    }
+    else if (value.IsString())
+    {
+        this->StoreSlot(slotOffset, BinaryType::String, this->WriteString(value.GetString()));
+    }
+    else if (value.IsVector())
+    {
+        this->StoreSlot(slotOffset, BinaryType::Vector, this->WriteVector(value.GetVector()));
+    }
+    else if (value.IsDict())
+    {
+        this->StoreSlot(slotOffset, BinaryType::Dict, this->WriteDict(value.GetDict()));
+    }
+    else
+    {
+        this->StoreSlot(slotOffset, BinaryType::Null, 0);
+    }
+}
+
+// The record is reserved first so that everything it points to comes after it
+size_t Json::BinaryWriter::WriteDict(const Dict& dict)
+{
+    size_t count = dict.Size();
+    size_t offset = this->Reserve(::RECORD_HEADER_SIZE + count * (::ENTRY_SIZE + sizeof(unsigned int)), sizeof(unsigned int));
+    size_t entryOffset = offset + ::RECORD_HEADER_SIZE;
+    Json::StoreUInt(this->buffer, offset, count);
+
+    for (const auto& i : dict)
+    {
+        Json::StoreUInt(this->buffer, entryOffset, Json::HashBinaryKey(i.first));
+        Json::StoreUInt(this->buffer, entryOffset + 4, this->WriteString(i.first));
+        this->WriteValue(i.second, entryOffset + 8);
+        entryOffset += ::ENTRY_SIZE;
+    }
+
+    // Nothing else gets appended now, so the table can be sorted in place
+    const BYTE* entries = this->buffer.data() + offset + ::RECORD_HEADER_SIZE;
+    unsigned int* sorted = reinterpret_cast<unsigned int*>(this->buffer.data() + entryOffset);
+    for (size_t i = 0; i < count; i++)
+    {
+        sorted[i] = static_cast<unsigned int>(i);
+    }
+
+    std::sort(sorted, sorted + count, [entries](unsigned int lhs, unsigned int rhs)
+    {
+        return Json::ReadUInt(entries + lhs * ::ENTRY_SIZE) < Json::ReadUInt(entries + rhs * ::ENTRY_SIZE);
+    });
+
+    return offset;
+}
+
+size_t Json::BinaryWriter::WriteVector(const std::pmr::vector<Value>& values)
+{
+    size_t offset = this->Reserve(::RECORD_HEADER_SIZE + values.size() * ::SLOT_SIZE, sizeof(unsigned int));
+    Json::StoreUInt(this->buffer, offset, values.size());
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        this->WriteValue(values[i], offset + ::RECORD_HEADER_SIZE + i * ::SLOT_SIZE);
+    }
+
+    return offset;
+}
+
+// Room is reserved for the longest UTF-8, then the buffer is cut back to what was written
+size_t Json::BinaryWriter::WriteString(std::wstring_view value)
+{
+    size_t offset = this->Reserve(sizeof(unsigned int) + value.size() * 3 + 1, sizeof(unsigned int));
+    size_t length = Json::Utf16ToUtf8(value.data(), value.size(), reinterpret_cast<char*>(this->buffer.data() + offset + sizeof(unsigned int)));
+    Json::StoreUInt(this->buffer, offset, length);
+    this->buffer.resize(offset + sizeof(unsigned int) + length + 1);
+
+    return offset;
+}
+
+// Returns the aligned offset of new zeroed space at the end of the buffer
+size_t Json::BinaryWriter::Reserve(size_t size, size_t align)
+{
+    size_t offset = (this->buffer.size() + align - 1) & ~(align - 1);
+    this->buffer.resize(offset + size);
+    return offset;
+}
+
+void Json::BinaryWriter::StoreSlot(size_t slotOffset, BinaryType type, size_t data)
+{
+    Json::StoreUInt(this->buffer, slotOffset, static_cast<size_t>(type));
+    Json::StoreUInt(this->buffer, slotOffset + 4, data);
+}
+
+Json::Dict Json::ParseBinary(const void* data, size_t size)
+{
+    Value root = BinaryValue::GetRoot(data, size).ToValue();
+    return root.IsDict() ? root.GetDict() : Dict();
+}
+
+// Strings are transcoded into the document's arena, so the buffer isn't kept
+Json::Document Json::ParseDocumentBinary(const void* data, size_t size)
+{
+    if (!BinaryValue::IsBinary(data, size))
+    {
+        return Document();
+    }
+
+    Document document(size * 2);
+    Json::ParseDocumentBinary(data, size, document);
+    return document;
+}
+
+// Parses into the arena that the document already has
+bool Json::ParseDocumentBinary(const void* data, size_t size, Document& document)
+{
+    if (!BinaryValue::IsBinary(data, size))
+    {
+        return false;
+    }
+
+    if (!document.GetArena())
+    {
+        document = Document(size * 2);
+    }
+
+    // The root shares the parsed dict's arena storage instead of copying it
+    Value root = BinaryValue::GetRoot(data, size).ToValue(document.GetArena());
+    if (root.IsDict())
+    {
+        document.GetRoot() = root.GetDict();
+        return true;
+    }
+
+    return false;
+}
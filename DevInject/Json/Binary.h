@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include "Json/Document.h"
+
+namespace Json
+{
+    enum class BinaryType : unsigned int
+    {
+        Unset,
+        Null,
+        Bool,
+        Int,
+        Int64,
+        UInt64,
+        Double,
+        String,
+        Vector,
+        Dict,
+    };
+
+    // Reads one value right out of a binary message buffer, nothing is parsed or copied.
+    // Dicts have a table sorted by key hash, so keys are found without building a Dict.
+    // Strings and keys are stored as UTF-8, GetUtf8 and GetKeyAt read them in place.
+    // Every offset is checked, a bad message just reads as unset values.
+    class BinaryValue
+    {
+    public:
+        DEV_INJECT_API BinaryValue();
+
+        DEV_INJECT_API static bool IsBinary(const void* data, size_t size);
+        DEV_INJECT_API static BinaryValue GetRoot(const void* data, size_t size);
+
+        DEV_INJECT_API BinaryType GetType() const;
+        DEV_INJECT_API bool IsUnset() const;
+        DEV_INJECT_API bool GetBool() const;
+        DEV_INJECT_API int GetInt() const;
+        DEV_INJECT_API long long GetInt64() const;
+        DEV_INJECT_API unsigned long long GetUInt64() const;
+        DEV_INJECT_API double GetDouble() const;
+        DEV_INJECT_API std::string_view GetUtf8() const;
+        DEV_INJECT_API std::wstring GetString() const;
+
+        // Dicts and vectors
+        DEV_INJECT_API size_t Size() const;
+        DEV_INJECT_API BinaryValue GetAt(size_t index) const;
+        DEV_INJECT_API std::string_view GetKeyAt(size_t index) const;
+        DEV_INJECT_API BinaryValue Get(std::wstring_view key) const;
+
+        // Long strings are transcoded into the arena when there is one
+        DEV_INJECT_API Value ToValue(const std::shared_ptr<Arena>& arena = nullptr) const;
+
+    private:
+        BinaryValue(const BYTE* data, size_t size, const BYTE* slot, size_t parentOffset);
+
+        Value ToValue(const std::shared_ptr<Arena>& arena, size_t& budget) const;
+        const BYTE* GetRecord(size_t headerSize, size_t itemSize, size_t align) const;
+        BinaryValue GetEntryValue(const BYTE* record, size_t index) const;
+        std::string_view GetStringAt(size_t offset, size_t parentOffset) const;
+
+        const BYTE* data;
+        size_t size;
+        BinaryType type;
+        unsigned int payload;
+    };
+
+    // Appends the binary form of a Dict into one buffer, which is reused after Clear()
+    class BinaryWriter
+    {
+    public:
+        DEV_INJECT_API BinaryWriter();
+
+        DEV_INJECT_API void Clear();
+        DEV_INJECT_API void Write(const Dict& dict);
+
+        DEV_INJECT_API const BYTE* GetData() const;
+        DEV_INJECT_API size_t GetSize() const;
+
+        // Where an int value of the root's entry at the index is stored, so a message can be patched after it's written
+        DEV_INJECT_API static size_t GetRootIntOffset(size_t index);
+
+    private:
+        void WriteValue(const Value& value, size_t slotOffset);
+        size_t WriteDict(const Dict& dict);
+        size_t WriteVector(const std::pmr::vector<Value>& values);
+        size_t WriteString(std::wstring_view value);
+        size_t Reserve(size_t size, size_t align);
+        void StoreSlot(size_t slotOffset, BinaryType type, size_t data);
+
+        std::vector<BYTE> buffer;
+    };
+
+    DEV_INJECT_API Dict ParseBinary(const void* data, size_t size);
+    DEV_INJECT_API Document ParseDocumentBinary(const void* data, size_t size);
+
+    // Parses into an empty document, like one that was recycled for the next message
+    DEV_INJECT_API bool ParseDocumentBinary(const void* data, size_t size, Document& document);
+}
@@ -0,0 +1,141 @@
+﻿#include "stdafx.h"
+#include "Json/Binding.h"
+#include "Json/Persist.h"
+
+namespace Json
+{
+    static bool ReadDigits(const Value& value, bool allowMinus, std::wstring& digits);
+}
+
+// The whole string has to be digits, so "12abc" isn't read as 12
+bool Json::ReadDigits(const Value& value, bool allowMinus, std::wstring& digits)
+{
+    if (!value.IsString())
+    {
+        return false;
+    }
+
+    std::wstring_view text = value.GetString();
+    size_t start = (allowMinus && !text.empty() && text[0] == L'-') ? 1 : 0;
+
+    if (text.size() == start || text.find_first_not_of(L"0123456789", start) != std::wstring_view::npos)
+    {
+        return false;
+    }
+
+    digits = text;
+    return true;
+}
+
+bool Json::ReadSigned(const Value& value, long long& result)
+{
+    if (value.IsInt64())
+    {
+        result = value.GetInt64();
+        return true;
+    }
+
+    std::wstring digits;
+    if (Json::ReadDigits(value, true, digits))
+    {
+        errno = 0;
+        result = std::wcstoll(digits.c_str(), nullptr, 10);
+        return errno != ERANGE;
+    }
+
+    return false;
+}
+
+bool Json::ReadUnsigned(const Value& value, unsigned long long& result)
+{
+    if (value.IsUInt64())
+    {
+        result = value.GetUInt64();
+        return true;
+    }
+
+    std::wstring digits;
+    if (Json::ReadDigits(value, false, digits))
+    {
+        errno = 0;
+        result = std::wcstoull(digits.c_str(), nullptr, 10);
+        return errno != ERANGE;
+    }
+
+    return false;
+}
+
+// Recursion is bounded by the same depth limit as Json::Parse
+Json::Value Json::ReadValue(Reader& reader)
+{
+    if (reader.GetDepth() > ParseLimits().maxDepth)
+    {
+        return Value();
+    }
+
+    switch (reader.GetEvent())
+    {
+    case ReaderEvent::BeginObject:
+        {
+            Dict dict;
+
+            while (reader.Next() == ReaderEvent::Key)
+            {
+                Value key = reader.GetValue();
+                reader.Next();
+
+                Value value = Json::ReadValue(reader);
+                if (value.IsUnset())
+                {
+                    return Value();
+                }
+
+                dict.Set(key.GetString(), std::move(value));
+            }
+
+            return (reader.GetEvent() == ReaderEvent::EndObject) ? Value(std::move(dict)) : Value();
+        }
+
+    case ReaderEvent::BeginArray:
+        {
+            std::pmr::vector<Value> values;
+
+            while (reader.Next() != ReaderEvent::EndArray)
+            {
+                Value value = Json::ReadValue(reader);
+                if (value.IsUnset())
+                {
+                    return Value();
+                }
+
+                values.push_back(std::move(value));
+            }
+
+            return Value(std::move(values));
+        }
+
+    default:
+        return reader.GetValue();
+    }
+}
+
+bool Json::ReadScalar(Reader& reader, Value& value)
+{
+    switch (reader.GetEvent())
+    {
+    case ReaderEvent::BeginObject:
+    case ReaderEvent::BeginArray:
+        value = Value();
+        return reader.Skip();
+
+    case ReaderEvent::String:
+    case ReaderEvent::Number:
+    case ReaderEvent::Bool:
+    case ReaderEvent::Null:
+        value = reader.GetValue();
+        return true;
+
+    default:
+        return false;
+    }
+}
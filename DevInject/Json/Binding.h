@@ -0,0 +1,468 @@
+﻿#pragma once
+
+#include "Json/Dict.h"
+#include "Json/Reader.h"
+#include "Json/Writer.h"
+
+namespace Json
+{
+    // Binds the members of a plain struct to the keys of a JSON object. The struct lists its fields once:
+    //
+    //     static auto Fields() { return std::make_tuple(Json::MakeField(Json::Keys::Title, &Info::title), ...); }
+    //
+    // Then Read() fills it from a Dict or a Reader, and ToDict() or Write() turn it back into JSON.
+    // Missing fields and fields with the wrong type keep the value they already had.
+
+    enum class FieldFormat
+    {
+        Default,
+        String, // numbers that were always sent as decimal strings
+    };
+
+    // Numbers can also come in as decimal strings
+    DEV_INJECT_API bool ReadSigned(const Value& value, long long& result);
+    DEV_INJECT_API bool ReadUnsigned(const Value& value, unsigned long long& result);
+
+    // Builds the value that the reader's current event starts, containers are read to their end
+    DEV_INJECT_API Value ReadValue(Reader& reader);
+
+    // Scalars come right from the current token, an object or array where a scalar belongs is skipped and stays unset.
+    // Returns false when the text can't be read.
+    DEV_INJECT_API bool ReadScalar(Reader& reader, Value& value);
+
+    template<class T, class Enable = void>
+    struct FieldValue;
+
+    // Structs with their own Fields() can be members of other bound structs
+    template<class T, class Enable = void>
+    struct HasFields : std::false_type
+    {
+    };
+
+    template<class T>
+    struct HasFields<T, std::void_t<decltype(T::Fields())>> : std::true_type
+    {
+    };
+
+    template<class T> void Read(const Dict& dict, T& object);
+    template<class T> bool ReadObject(Reader& reader, T& object);
+    template<class T> Dict ToDict(const T& object);
+    template<class T> void Write(Writer& writer, const T& object);
+
+    // Reads the value of a bound key. Only objects and arrays that a field keeps get built.
+    template<class T>
+    bool ReadFieldValue(Reader& reader, T& result)
+    {
+        Value value;
+
+        if constexpr (HasFields<T>::value)
+        {
+            if (reader.GetEvent() == ReaderEvent::BeginObject)
+            {
+                return Json::ReadObject(reader, result);
+            }
+        }
+
+        if constexpr (std::is_same_v<T, Dict> || std::is_same_v<T, Value>)
+        {
+            value = Json::ReadValue(reader);
+            if (value.IsUnset())
+            {
+                return false;
+            }
+        }
+        else if (!Json::ReadScalar(reader, value))
+        {
+            return false;
+        }
+
+        FieldValue<T>::Read(value, result);
+        return true;
+    }
+
+    template<>
+    struct FieldValue<std::wstring>
+    {
+        static bool Read(const Value& value, std::wstring& result)
+        {
+            if (value.IsString())
+            {
+                result = value.GetString();
+                return true;
+            }
+
+            return false;
+        }
+
+        static Value ToValue(const std::wstring& value, FieldFormat format)
+        {
+            return Value(std::wstring_view(value));
+        }
+
+        static void Write(Writer& writer, const std::wstring& value, FieldFormat format)
+        {
+            writer.WriteString(value);
+        }
+    };
+
+    template<>
+    struct FieldValue<bool>
+    {
+        static bool Read(const Value& value, bool& result)
+        {
+            if (value.IsBool())
+            {
+                result = value.GetBool();
+                return true;
+            }
+
+            return false;
+        }
+
+        static Value ToValue(bool value, FieldFormat format)
+        {
+            return Value(value);
+        }
+
+        static void Write(Writer& writer, bool value, FieldFormat format)
+        {
+            writer.Write(Value(value));
+        }
+    };
+
+    template<>
+    struct FieldValue<HWND>
+    {
+        static bool Read(const Value& value, HWND& result)
+        {
+            HWND hwnd = value.TryGetHwnd();
+            if (hwnd)
+            {
+                result = hwnd;
+                return true;
+            }
+
+            return false;
+        }
+
+        static Value ToValue(HWND value, FieldFormat format)
+        {
+            return (format == FieldFormat::String)
+                ? Value(std::to_wstring(reinterpret_cast<size_t>(value)))
+                : Value(value);
+        }
+
+        static void Write(Writer& writer, HWND value, FieldFormat format)
+        {
+            writer.Write(FieldValue::ToValue(value, format));
+        }
+    };
+
+    // Any integer type, the value must fit or it isn't used
+    template<class T>
+    struct FieldValue<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    {
+        static bool Read(const Value& value, T& result)
+        {
+            if constexpr (std::is_signed_v<T>)
+            {
+                long long number;
+                if (Json::ReadSigned(value, number) && number >= std::numeric_limits<T>::min() && number <= std::numeric_limits<T>::max())
+                {
+                    result = static_cast<T>(number);
+                    return true;
+                }
+            }
+            else
+            {
+                unsigned long long number;
+                if (Json::ReadUnsigned(value, number) && number <= std::numeric_limits<T>::max())
+                {
+                    result = static_cast<T>(number);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        static Value ToValue(T value, FieldFormat format)
+        {
+            if (format == FieldFormat::String)
+            {
+                return Value(std::to_wstring(value));
+            }
+
+            if constexpr (std::is_signed_v<T>)
+            {
+                return Value(static_cast<long long>(value));
+            }
+            else
+            {
+                return Value(static_cast<unsigned long long>(value));
+            }
+        }
+
+        static void Write(Writer& writer, T value, FieldFormat format)
+        {
+            writer.Write(FieldValue::ToValue(value, format));
+        }
+    };
+
+    // Copies share entries, so nested objects like the environment aren't duplicated
+    template<>
+    struct FieldValue<Dict>
+    {
+        static bool Read(const Value& value, Dict& result)
+        {
+            if (value.IsDict())
+            {
+                result = value.GetDict();
+                return true;
+            }
+
+            return false;
+        }
+
+        static Value ToValue(const Dict& value, FieldFormat format)
+        {
+            return Value(Dict(value));
+        }
+
+        static void Write(Writer& writer, const Dict& value, FieldFormat format)
+        {
+            writer.Write(value);
+        }
+    };
+
+    // Any value at all, it's kept unset when the key is missing
+    template<>
+    struct FieldValue<Value>
+    {
+        static bool Read(const Value& value, Value& result)
+        {
+            if (!value.IsUnset())
+            {
+                result = value;
+                return true;
+            }
+
+            return false;
+        }
+
+        static Value ToValue(const Value& value, FieldFormat format)
+        {
+            return value;
+        }
+
+        static void Write(Writer& writer, const Value& value, FieldFormat format)
+        {
+            writer.Write(value);
+        }
+    };
+
+    // A nested bound struct
+    template<class T>
+    struct FieldValue<T, std::enable_if_t<HasFields<T>::value>>
+    {
+        static bool Read(const Value& value, T& result)
+        {
+            if (value.IsDict())
+            {
+                Json::Read(value.GetDict(), result);
+                return true;
+            }
+
+            return false;
+        }
+
+        static Value ToValue(const T& value, FieldFormat format)
+        {
+            return Value(Json::ToDict(value));
+        }
+
+        static void Write(Writer& writer, const T& value, FieldFormat format)
+        {
+            Json::Write(writer, value);
+        }
+    };
+
+    // One member stored under one key
+    template<class T, class M>
+    struct Field
+    {
+        Key key;
+        M T::* member;
+        FieldFormat format;
+
+        void Read(const Dict& dict, T& object) const
+        {
+            const Value* value = dict.Find(this->key);
+            if (value)
+            {
+                FieldValue<M>::Read(*value, object.*this->member);
+            }
+        }
+
+        // Returns true when the reader is on this field's key, valid is false if its value can't be read
+        bool Read(Reader& reader, T& object, bool& valid) const
+        {
+            if (!reader.KeyEquals(this->key.GetName()))
+            {
+                return false;
+            }
+
+            reader.Next();
+            valid = Json::ReadFieldValue(reader, object.*this->member);
+            return true;
+        }
+
+        void AddTo(Dict& dict, const T& object) const
+        {
+            dict.Set(this->key, FieldValue<M>::ToValue(object.*this->member, this->format));
+        }
+
+        void Write(Writer& writer, const T& object) const
+        {
+            writer.WriteKey(this->key.GetName());
+            FieldValue<M>::Write(writer, object.*this->member, this->format);
+        }
+    };
+
+    // A fixed size array member stored under the keys "0" to "N-1" of the same object
+    template<class T, class E, size_t N>
+    struct IndexedField
+    {
+        std::array<E, N> T::* member;
+        FieldFormat format;
+
+        void Read(const Dict& dict, T& object) const
+        {
+            for (size_t i = 0; i < N; i++)
+            {
+                const Value* value = dict.Find(std::to_wstring(i));
+                if (value)
+                {
+                    FieldValue<E>::Read(*value, (object.*this->member)[i]);
+                }
+            }
+        }
+
+        bool Read(Reader& reader, T& object, bool& valid) const
+        {
+            Value keyValue = reader.GetValue();
+            std::wstring_view key = keyValue.IsString() ? keyValue.GetString() : std::wstring_view();
+            size_t index = 0;
+            if (key.empty() || (key.size() > 1 && key[0] == L'0'))
+            {
+                return false;
+            }
+
+            for (wchar_t ch : key)
+            {
+                if (ch < L'0' || ch > L'9' || (index = index * 10 + (ch - L'0')) >= N)
+                {
+                    return false;
+                }
+            }
+
+            reader.Next();
+            valid = Json::ReadFieldValue(reader, (object.*this->member)[index]);
+            return true;
+        }
+
+        void AddTo(Dict& dict, const T& object) const
+        {
+            for (size_t i = 0; i < N; i++)
+            {
+                dict.Set(std::to_wstring(i), FieldValue<E>::ToValue((object.*this->member)[i], this->format));
+            }
+        }
+
+        void Write(Writer& writer, const T& object) const
+        {
+            for (size_t i = 0; i < N; i++)
+            {
+                writer.WriteKey(std::to_wstring(i));
+                FieldValue<E>::Write(writer, (object.*this->member)[i], this->format);
+            }
+        }
+    };
+
+    template<class T, class M>
+    constexpr Field<T, M> MakeField(const Key& key, M T::* member, FieldFormat format = FieldFormat::Default)
+    {
+        return Field<T, M>{ key, member, format };
+    }
+
+    template<class T, class E, size_t N>
+    constexpr IndexedField<T, E, N> MakeIndexedField(std::array<E, N> T::* member, FieldFormat format = FieldFormat::Default)
+    {
+        return IndexedField<T, E, N>{ member, format };
+    }
+
+    template<class T>
+    void Read(const Dict& dict, T& object)
+    {
+        std::apply([&dict, &object](const auto&... fields)
+        {
+            (fields.Read(dict, object), ...);
+        }, T::Fields());
+    }
+
+    // The reader is on the object's BeginObject. Keys that aren't bound are skipped without building their values.
+    template<class T>
+    bool ReadObject(Reader& reader, T& object)
+    {
+        auto fields = T::Fields();
+
+        while (reader.Next() == ReaderEvent::Key)
+        {
+            bool valid = true;
+            bool bound = std::apply([&reader, &object, &valid](const auto&... fields)
+            {
+                return (fields.Read(reader, object, valid) || ...);
+            }, fields);
+
+            if (bound ? !valid : !reader.Skip())
+            {
+                return false;
+            }
+        }
+
+        return reader.GetEvent() == ReaderEvent::EndObject;
+    }
+
+    // Reads the next object right out of the text
+    template<class T>
+    bool Read(Reader& reader, T& object)
+    {
+        return reader.Next() == ReaderEvent::BeginObject && Json::ReadObject(reader, object);
+    }
+
+    template<class T>
+    Dict ToDict(const T& object)
+    {
+        Dict dict;
+
+        std::apply([&dict, &object](const auto&... fields)
+        {
+            (fields.AddTo(dict, object), ...);
+        }, T::Fields());
+
+        return dict;
+    }
+
+    template<class T>
+    void Write(Writer& writer, const T& object)
+    {
+        writer.BeginObject();
+
+        std::apply([&writer, &object](const auto&... fields)
+        {
+            (fields.Write(writer, object), ...);
+        }, T::Fields());
+
+        writer.EndObject();
+    }
+}
@@ -0,0 +1,516 @@
+﻿#include "stdafx.h"
+#include "Json/Binary.h"
+#include "Json/ChunkParser.h"
+#include "Json/Lazy.h"
+#include "Json/Utf8.h"
+
+// Most messages fit in the first block, big ones like the environment get more blocks
+static const size_t INITIAL_ARENA_SIZE = 16384;
+
+namespace Json
+{
+    static size_t GetUtf8SequenceLength(unsigned char lead);
+    static size_t GetCompleteUtf8Length(const char* data, size_t size);
+}
+
+// Invalid lead bytes count as one char, the transcoder replaces them
+size_t Json::GetUtf8SequenceLength(unsigned char lead)
+{
+    return (lead >= 0xC2 && lead <= 0xDF) ? 2 : (lead >= 0xE0 && lead <= 0xEF) ? 3 : (lead >= 0xF0 && lead <= 0xF4) ? 4 : 1;
+}
+
+// Leaves off a sequence at the end that needs bytes from the next chunk
+size_t Json::GetCompleteUtf8Length(const char* data, size_t size)
+{
+    for (size_t i = 1; i <= 3 && i <= size; i++)
+    {
+        unsigned char ch = static_cast<unsigned char>(data[size - i]);
+        if ((ch & 0xC0) != 0x80)
+        {
+            return (Json::GetUtf8SequenceLength(ch) > i) ? size - i : size;
+        }
+    }
+
+    return size;
+}
+
+Json::ChunkParser::ChunkParser(const ParseLimits& limits)
+    : limits(limits)
+    , lazy(false)
+{
+    this->Reset();
+}
+
+void Json::ChunkParser::Reset()
+{
+    // The last message's arena is reused when nothing kept a value from it
+    this->stack.clear();
+    this->entries.clear();
+    this->format = Format::Unknown;
+    if (!this->document.Recycle())
+    {
+        this->document = Document(::INITIAL_ARENA_SIZE);
+    }
+
+    this->text.clear();
+    this->carry.clear();
+    this->binary.clear();
+    this->textOffset = 0;
+    this->textUsed = 0;
+    this->lazyStart = std::wstring::npos;
+    this->messageSize = 0;
+    this->nodes = 0;
+    this->errorPos = std::wstring::npos;
+    this->done = false;
+}
+
+// For a message that's known to be UTF-8 text, its first bytes aren't checked for another format
+void Json::ChunkParser::ResetUtf8()
+{
+    this->Reset();
+    this->format = Format::Utf8;
+}
+
+// Stays set for every message after this one
+void Json::ChunkParser::SetLazy(bool lazy)
+{
+    this->lazy = lazy;
+}
+
+// Returns false once the text can't be valid anymore, the rest of the message can be ignored
+bool Json::ChunkParser::Feed(const void* data, size_t size)
+{
+    const BYTE* bytes = static_cast<const BYTE*>(data);
+
+    // Nothing more is kept once the message is too big, the rest of it is just counted
+    this->messageSize += size;
+    if (this->messageSize > this->limits.maxMessageSize)
+    {
+        if (this->errorPos == std::wstring::npos)
+        {
+            this->errorPos = this->textOffset + this->text.size();
+            this->text.clear();
+            this->binary.clear();
+            this->binary.shrink_to_fit();
+        }
+
+        return false;
+    }
+
+    if (this->format == Format::Unknown)
+    {
+        // Binary starts with its magic byte, UTF-16 text has a zero second byte
+        if (this->carry.size() + size < 2)
+        {
+            this->carry.append(reinterpret_cast<const char*>(bytes), size);
+            return true;
+        }
+
+        BYTE first = this->carry.empty() ? bytes[0] : static_cast<BYTE>(this->carry[0]);
+        BYTE second = this->carry.empty() ? bytes[1] : bytes[0];
+
+        if (first == 0xFE)
+        {
+            this->format = Format::Binary;
+            this->binary.assign(this->carry.begin(), this->carry.end());
+            this->carry.clear();
+        }
+        else
+        {
+            this->format = second ? Format::Utf8 : Format::Utf16;
+        }
+    }
+
+    if (this->format == Format::Binary)
+    {
+        this->binary.insert(this->binary.end(), bytes, bytes + size);
+        return true;
+    }
+
+    if (this->done || this->errorPos != std::wstring::npos)
+    {
+        return this->errorPos == std::wstring::npos;
+    }
+
+    if (this->format == Format::Utf8)
+    {
+        this->AppendUtf8(reinterpret_cast<const char*>(bytes), size);
+    }
+    else
+    {
+        this->AppendUtf16(bytes, size);
+    }
+
+    this->ParseText(false);
+    return this->errorPos == std::wstring::npos;
+}
+
+// Called when the message is done, returns true when it was one whole object
+bool Json::ChunkParser::Finish()
+{
+    if (this->format == Format::Binary && this->errorPos == std::wstring::npos)
+    {
+        // The document was recycled by Reset(), so its arena is reused for binary messages too
+        bool valid = Json::ParseDocumentBinary(this->binary.data(), this->binary.size(), this->document);
+        this->binary.clear();
+        return valid;
+    }
+
+    if (this->format == Format::Unknown && !this->carry.empty())
+    {
+        this->format = Format::Utf8;
+    }
+
+    if (!this->done && this->errorPos == std::wstring::npos)
+    {
+        // Whatever is left of a split char is invalid now
+        if (this->format == Format::Utf8 && !this->carry.empty())
+        {
+            size_t size = this->text.size();
+            this->text.resize(size + this->carry.size());
+            this->text.resize(size + Json::Utf8ToUtf16(this->carry.data(), this->carry.size(), &this->text[size]));
+            this->carry.clear();
+        }
+
+        this->ParseText(true);
+    }
+
+    return this->done && this->errorPos == std::wstring::npos;
+}
+
+bool Json::ChunkParser::IsBinary() const
+{
+    return this->format == Format::Binary;
+}
+
+// Counted in UTF-16 chars from the start of the text
+size_t Json::ChunkParser::GetErrorPos() const
+{
+    return this->errorPos;
+}
+
+const Json::Document& Json::ChunkParser::GetDocument() const
+{
+    return this->document;
+}
+
+Json::Document Json::ChunkParser::TakeDocument()
+{
+    Document document = std::move(this->document);
+    this->Reset();
+    return document;
+}
+
+void Json::ChunkParser::AppendUtf8(const char* data, size_t size)
+{
+    // Finish the char that was split by the last chunk
+    while (!this->carry.empty() && this->carry.size() < Json::GetUtf8SequenceLength(this->carry[0]) && size)
+    {
+        this->carry.push_back(*data++);
+        size--;
+    }
+
+    size_t completeSize = Json::GetCompleteUtf8Length(data, size);
+    size_t carrySize = this->carry.size();
+    size_t textSize = this->text.size();
+
+    if (carrySize && carrySize < Json::GetUtf8SequenceLength(this->carry[0]))
+    {
+        // Still not enough bytes
+        return;
+    }
+
+    this->text.resize(textSize + carrySize + completeSize);
+    textSize += Json::Utf8ToUtf16(this->carry.data(), carrySize, &this->text[textSize]);
+    textSize += Json::Utf8ToUtf16(data, completeSize, &this->text[textSize]);
+    this->text.resize(textSize);
+
+    this->carry.assign(data + completeSize, size - completeSize);
+}
+
+void Json::ChunkParser::AppendUtf16(const BYTE* data, size_t size)
+{
+    // A char can be split between chunks too
+    while (!this->carry.empty() && this->carry.size() < sizeof(wchar_t) && size)
+    {
+        this->carry.push_back(static_cast<char>(*data++));
+        size--;
+    }
+
+    if (this->carry.size() == sizeof(wchar_t))
+    {
+        wchar_t ch;
+        std::memcpy(&ch, this->carry.data(), sizeof(ch));
+        this->text.push_back(ch);
+        this->carry.clear();
+    }
+
+    size_t textSize = this->text.size();
+    size_t charCount = size / sizeof(wchar_t);
+    this->text.resize(textSize + charCount);
+    std::memcpy(&this->text[textSize], data, charCount * sizeof(wchar_t));
+
+    this->carry.append(reinterpret_cast<const char*>(data) + charCount * sizeof(wchar_t), size % sizeof(wchar_t));
+}
+
+// Parses every token that is known to be whole, the rest stays in the text for next time
+void Json::ChunkParser::ParseText(bool final)
+{
+    // The text before textUsed was parsed already, it's only kept for a lazy value that hasn't ended
+    Tokenizer tokenizer(this->text.c_str() + this->textUsed, this->text.size() - this->textUsed);
+    const wchar_t* consumed = this->text.c_str() + this->textUsed;
+
+    while (!this->done && this->errorPos == std::wstring::npos)
+    {
+        Token token = tokenizer.NextToken();
+        if (tokenizer.ReachedEnd() && !final)
+        {
+            // A token that keeps going can't be a string under the limit
+            if (this->text.c_str() + this->text.size() - token.start > static_cast<ptrdiff_t>(this->limits.maxStringLength + 2))
+            {
+                this->errorPos = this->textOffset + (token.start - this->text.c_str());
+            }
+
+            break;
+        }
+
+        if (!this->ParseToken(token))
+        {
+            this->errorPos = this->textOffset + (token.start - this->text.c_str());
+            break;
+        }
+
+        consumed = token.start + token.length;
+    }
+
+    size_t consumedSize = consumed - this->text.c_str();
+    size_t eraseSize = (this->lazyStart != std::wstring::npos) ? this->lazyStart - this->textOffset : consumedSize;
+    this->textOffset += eraseSize;
+    this->text.erase(0, eraseSize);
+    this->textUsed = consumedSize - eraseSize;
+}
+
+// Same grammar as Json::Parse, the state for each open object or array is on the stack
+bool Json::ChunkParser::ParseToken(const Token& token)
+{
+    if (this->stack.empty())
+    {
+        if (token.type != TokenType::OpenCurly)
+        {
+            return false;
+        }
+
+        const std::shared_ptr<Arena>& arena = this->document.GetArena();
+        this->stack.push_back(Frame{ Json::MakeShared<Dict>(arena, arena), nullptr, Value(), State::KeyOrEnd, 0, true, false });
+        return true;
+    }
+
+    Frame& frame = this->stack.back();
+    bool object = frame.object;
+
+    switch (frame.state)
+    {
+    case State::KeyOrEnd:
+        if (token.type == TokenType::CloseCurly)
+        {
+            this->EndContainer(token);
+            return true;
+        }
+
+        if (token.type != TokenType::String || token.length - 2 > this->limits.maxStringLength)
+        {
+            return false;
+        }
+
+        // Keys in a lazy value get parsed with the rest of its text
+        frame.key = frame.skipped ? Value() : this->GetValue(token);
+        frame.state = State::Colon;
+        return frame.skipped || !frame.key.IsUnset();
+
+    case State::Colon:
+        frame.state = State::Value;
+        return token.type == TokenType::Colon;
+
+    case State::Value:
+        if (!object && token.type == TokenType::CloseBracket)
+        {
+            this->EndContainer(token);
+            return true;
+        }
+
+        return this->StartValue(token);
+
+    case State::CommaOrEnd:
+        if (token.type == TokenType::Comma)
+        {
+            frame.state = object ? State::KeyOrEnd : State::Value;
+            return true;
+        }
+
+        if (token.type == (object ? TokenType::CloseCurly : TokenType::CloseBracket))
+        {
+            this->EndContainer(token);
+            return true;
+        }
+
+        return false;
+    }
+
+    return false;
+}
+
+bool Json::ChunkParser::StartValue(const Token& token)
+{
+    const std::shared_ptr<Arena>& arena = this->document.GetArena();
+
+    if (++this->nodes > this->limits.maxNodes)
+    {
+        return false;
+    }
+
+    if (token.type == TokenType::OpenCurly || token.type == TokenType::OpenBracket)
+    {
+        if (this->stack.size() >= this->limits.maxDepth)
+        {
+            return false;
+        }
+
+        // The parent gets the value when it ends
+        Frame& parent = this->stack.back();
+        parent.state = State::CommaOrEnd;
+
+        // Only the root's own values get parsed, the text of a lazy value is kept from its first token
+        if (this->lazy)
+        {
+            if (!parent.skipped)
+            {
+                this->lazyStart = this->textOffset + (token.start - this->text.c_str());
+                this->lazyLimits = this->limits;
+                this->lazyLimits.maxDepth -= this->stack.size();
+                this->lazyLimits.maxNodes -= this->nodes;
+            }
+
+            bool object = (token.type == TokenType::OpenCurly);
+            this->stack.push_back(Frame{ nullptr, nullptr, Value(), object ? State::KeyOrEnd : State::Value, 0, object, true });
+        }
+        else if (token.type == TokenType::OpenCurly)
+        {
+            this->stack.push_back(Frame{ Json::MakeShared<Dict>(arena, arena), nullptr, Value(), State::KeyOrEnd, this->entries.size(), true, false });
+        }
+        else
+        {
+            this->stack.push_back(Frame{ nullptr, Json::MakeShared<std::pmr::vector<Value>>(arena, arena->GetResource()), Value(), State::Value, this->entries.size(), false, false });
+        }
+
+        return true;
+    }
+
+    if (this->stack.back().skipped)
+    {
+        this->stack.back().state = State::CommaOrEnd;
+        return (token.type != TokenType::String || token.length - 2 <= this->limits.maxStringLength) && token.HasValue();
+    }
+
+    Value value = (token.type != TokenType::String || token.length - 2 <= this->limits.maxStringLength) ? this->GetValue(token) : Value();
+    if (value.IsUnset())
+    {
+        return false;
+    }
+
+    this->stack.back().state = State::CommaOrEnd;
+    this->AddValue(std::move(value));
+    return true;
+}
+
+void Json::ChunkParser::AddValue(Value&& value)
+{
+    this->entries.emplace_back(std::move(this->stack.back().key), std::move(value));
+}
+
+void Json::ChunkParser::EndContainer(const Token& token)
+{
+    Frame frame = std::move(this->stack.back());
+    this->stack.pop_back();
+
+    if (frame.skipped)
+    {
+        // The root is never skipped, so there's a parent
+        if (!this->stack.back().skipped)
+        {
+            const std::shared_ptr<Arena>& arena = this->document.GetArena();
+            const wchar_t* start = this->text.c_str() + (this->lazyStart - this->textOffset);
+            size_t length = token.start + token.length - start;
+
+            wchar_t* chars = arena->AllocateString(length);
+            std::copy(start, start + length, chars);
+            this->lazyStart = std::wstring::npos;
+
+            this->AddValue(Value(Json::MakeShared<LazyValue>(arena, std::shared_ptr<const wchar_t>(arena, chars), length, this->lazyLimits)));
+        }
+
+        return;
+    }
+
+    this->FillContainer(frame);
+
+    if (this->stack.empty())
+    {
+        this->document.GetRoot() = std::move(*frame.dict);
+        this->done = true;
+    }
+    else if (frame.dict)
+    {
+        this->AddValue(Value(std::move(frame.dict)));
+    }
+    else
+    {
+        this->AddValue(Value(std::move(frame.vector)));
+    }
+}
+
+// Growing the dict or vector while values arrive would leave the old copies in the arena
+void Json::ChunkParser::FillContainer(Frame& frame)
+{
+    std::vector<std::pair<Value, Value>>::iterator first = this->entries.begin() + frame.firstEntry;
+    size_t count = this->entries.end() - first;
+
+    if (frame.dict)
+    {
+        frame.dict->Reserve(count);
+        for (std::vector<std::pair<Value, Value>>::iterator i = first; i != this->entries.end(); i++)
+        {
+            frame.dict->Set(i->first.GetString(), std::move(i->second));
+        }
+    }
+    else
+    {
+        frame.vector->reserve(count);
+        for (std::vector<std::pair<Value, Value>>::iterator i = first; i != this->entries.end(); i++)
+        {
+            frame.vector->push_back(std::move(i->second));
+        }
+    }
+
+    this->entries.erase(first, this->entries.end());
+}
+
+// The text is reused for the next chunk, so long strings without escapes get copied into the arena
+Json::Value Json::ChunkParser::GetValue(const Token& token) const
+{
+    const std::shared_ptr<Arena>& arena = this->document.GetArena();
+
+    if (token.type == TokenType::String && !token.escaped)
+    {
+        std::wstring_view chars(token.start + 1, token.length - 2);
+        if (chars.size() <= Value::SHORT_STRING_SIZE)
+        {
+            return Value(chars);
+        }
+
+        wchar_t* arenaChars = arena->AllocateString(chars.size());
+        std::copy(chars.begin(), chars.end(), arenaChars);
+        return Value(std::shared_ptr<const wchar_t>(arena, arenaChars), chars.size());
+    }
+
+    return token.GetValue(arena);
+}
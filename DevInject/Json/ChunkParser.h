@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include "Json/Document.h"
+#include "Json/Persist.h"
+#include "Json/Tokenizer.h"
+
+namespace Json
+{
+    // Parses one message while it is still arriving. Each chunk is fed in as soon as it's read,
+    // a token or UTF-8 char that got split between chunks waits for the next one.
+    // Text can be UTF-8 or UTF-16, binary messages are collected and parsed by Finish().
+    // In lazy mode, nested objects and arrays are checked but kept as text until they're used, like ParseDocumentLazy.
+    class ChunkParser
+    {
+    public:
+        DEV_INJECT_API ChunkParser(const ParseLimits& limits = ParseLimits());
+
+        DEV_INJECT_API void Reset();
+        DEV_INJECT_API void ResetUtf8();
+        DEV_INJECT_API void SetLazy(bool lazy);
+        DEV_INJECT_API bool Feed(const void* data, size_t size);
+        DEV_INJECT_API bool Finish();
+
+        DEV_INJECT_API bool IsBinary() const;
+        DEV_INJECT_API size_t GetErrorPos() const;
+        DEV_INJECT_API const Document& GetDocument() const;
+        DEV_INJECT_API Document TakeDocument();
+
+    private:
+        enum class Format
+        {
+            Unknown,
+            Utf8,
+            Utf16,
+            Binary,
+        };
+
+        enum class State
+        {
+            KeyOrEnd,
+            Colon,
+            Value,
+            CommaOrEnd,
+        };
+
+        struct Frame
+        {
+            std::shared_ptr<Dict> dict;
+            std::shared_ptr<std::pmr::vector<Value>> vector;
+            Value key;
+            State state;
+            size_t firstEntry;
+            bool object;
+            bool skipped; // inside a lazy value, so nothing gets parsed
+        };
+
+        void AppendUtf8(const char* data, size_t size);
+        void AppendUtf16(const BYTE* data, size_t size);
+        void ParseText(bool final);
+        bool ParseToken(const Token& token);
+        bool StartValue(const Token& token);
+        void AddValue(Value&& value);
+        void EndContainer(const Token& token);
+        void FillContainer(Frame& frame);
+        Value GetValue(const Token& token) const;
+
+        ParseLimits limits;
+        Format format;
+        Document document;
+        std::vector<Frame> stack;
+        // Keys and values wait here until their object or array ends, then it's allocated at its final size
+        std::vector<std::pair<Value, Value>> entries;
+        std::wstring text;
+        std::string carry;
+        std::vector<BYTE> binary;
+        size_t textOffset;
+        size_t textUsed;
+        size_t lazyStart;
+        ParseLimits lazyLimits;
+        size_t messageSize;
+        size_t nodes;
+        size_t errorPos;
+        bool done;
+        bool lazy;
+    };
+}
@@ -0,0 +1,73 @@
+﻿#include "stdafx.h"
+#include "Json/Context.h"
+
+// Same as the pipe's buffer size, so one read gets a whole chunk
+static const DWORD READ_BUFFER_SIZE = 65536;
+
+Json::ParseContext::ParseContext(const ParseLimits& limits)
+    : parser(limits)
+    , buffer(::READ_BUFFER_SIZE)
+    , event(::CreateEvent(nullptr, TRUE, FALSE, nullptr))
+{
+}
+
+Json::ParseContext::~ParseContext()
+{
+    if (this->event)
+    {
+        ::CloseHandle(this->event);
+    }
+}
+
+Json::ChunkParser& Json::ParseContext::GetParser()
+{
+    return this->parser;
+}
+
+BYTE* Json::ParseContext::GetBuffer()
+{
+    return this->buffer.data();
+}
+
+DWORD Json::ParseContext::GetBufferSize() const
+{
+    return static_cast<DWORD>(this->buffer.size());
+}
+
+HANDLE Json::ParseContext::GetEvent() const
+{
+    return this->event;
+}
+
+Json::WriteContext::WriteContext()
+    : event(::CreateEvent(nullptr, TRUE, FALSE, nullptr))
+{
+}
+
+Json::WriteContext::~WriteContext()
+{
+    if (this->event)
+    {
+        ::CloseHandle(this->event);
+    }
+}
+
+Json::Writer& Json::WriteContext::GetWriter()
+{
+    return this->writer;
+}
+
+Json::BinaryWriter& Json::WriteContext::GetBinaryWriter()
+{
+    return this->binaryWriter;
+}
+
+HANDLE Json::WriteContext::GetEvent() const
+{
+    return this->event;
+}
+
+Json::Dict& Json::WriteContext::GetReply()
+{
+    return this->reply;
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "Json/Binary.h"
+#include "Json/ChunkParser.h"
+#include "Json/Writer.h"
+
+namespace Json
+{
+    // State for reading many messages in a row. The parser's arena and text, the read buffer and
+    // the event all get reused, so small messages stop allocating once the first few are read.
+    class ParseContext
+    {
+    public:
+        DEV_INJECT_API ParseContext(const ParseLimits& limits = ParseLimits());
+        DEV_INJECT_API ~ParseContext();
+
+        DEV_INJECT_API ChunkParser& GetParser();
+        DEV_INJECT_API BYTE* GetBuffer();
+        DEV_INJECT_API DWORD GetBufferSize() const;
+        DEV_INJECT_API HANDLE GetEvent() const;
+
+    private:
+        ChunkParser parser;
+        std::vector<BYTE> buffer;
+        HANDLE event;
+    };
+
+    // State for writing many messages in a row, both writers keep their buffers between messages
+    class WriteContext
+    {
+    public:
+        DEV_INJECT_API WriteContext();
+        DEV_INJECT_API ~WriteContext();
+
+        DEV_INJECT_API Writer& GetWriter();
+        DEV_INJECT_API BinaryWriter& GetBinaryWriter();
+        DEV_INJECT_API HANDLE GetEvent() const;
+
+        // Reply for handlers that return nothing, cleared after each write
+        DEV_INJECT_API Dict& GetReply();
+
+    private:
+        Writer writer;
+        BinaryWriter binaryWriter;
+        Dict reply;
+        HANDLE event;
+    };
+}
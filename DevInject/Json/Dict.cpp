@@ -1,129 +1,449 @@
 ﻿#include "stdafx.h"
 #include "Json/Dict.h"
+#include "Json/Path.h"
 #include "Json/Persist.h"
 
+// Below this size a linear search through the entries beats hashing the key
+static const size_t INDEX_THRESHOLD = 16;
+
+static const Json::Dict::EntriesType EMPTY_ENTRIES;
+static const size_t EMPTY_HASH = Json::HashKey(L"{}");
+
+// The index is kept at most a quarter full when it's rebuilt
+static size_t GetIndexSize(size_t count)
+{
+    size_t size = ::INDEX_THRESHOLD * 2;
+    while (size < count * 4)
+    {
+        size *= 2;
+    }
+
+    return size;
+}
+
+Json::Dict::Storage::Storage(std::pmr::memory_resource* resource)
+    : entries(resource)
+    , index(resource)
+    , hash(0)
+    , lent(false)
+{
+}
+
+// The copy is made to be changed, so the hash isn't copied
+Json::Dict::Storage::Storage(const Storage& rhs)
+    : entries(rhs.entries)
+    , index(rhs.index)
+    , hash(0)
+    , lent(false)
+{
+}
+
 Json::Dict::Dict()
 {
 }
 
+// Keys and entries are allocated from the arena until a copy of this Dict changes,
+// then the changed copy gets its own entries on the heap.
+Json::Dict::Dict(const std::shared_ptr<Arena>& arena)
+    : storage(Json::MakeShared<Storage>(arena, arena ? arena->GetResource() : std::pmr::get_default_resource()))
+{
+}
+
 Json::Dict::Dict(Dict&& rhs)
-    : values(std::move(rhs.values))
+    : storage(std::move(rhs.storage))
 {
 }
 
 Json::Dict::Dict(const Dict& rhs)
-    : values(rhs.values)
+    : storage(rhs.storage)
 {
 }
 
 const Json::Dict& Json::Dict::operator=(Dict&& rhs)
 {
-    this->values = std::move(rhs.values);
+    this->storage = std::move(rhs.storage);
     return *this;
 }
 
 const Json::Dict& Json::Dict::operator=(const Dict& rhs)
 {
-    this->values = rhs.values;
+    this->storage = rhs.storage;
     return *this;
 }
 
+// Order doesn't matter
 bool Json::Dict::operator==(const Dict& rhs) const
 {
-    return this->values == rhs.values;
+    if (this->storage == rhs.storage)
+    {
+        return true;
+    }
+
+    // Hashes are remembered, so comparing against the same Dict again is quick
+    if (this->Size() != rhs.Size() || this->GetHash() != rhs.GetHash())
+    {
+        return false;
+    }
+
+    for (const EntryType& entry : *this)
+    {
+        size_t i = rhs.FindEntry(entry.first);
+        if (i == std::wstring::npos || !(rhs.storage->entries[i].second == entry.second))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Entry hashes are added up so that order doesn't matter, just like operator==.
+// Shared storage never changes, so another thread can only compute the same hash.
+size_t Json::Dict::GetHash() const
+{
+    if (!this->Size())
+    {
+        return ::EMPTY_HASH;
+    }
+
+    size_t hash = this->storage->hash.load(std::memory_order_relaxed);
+    if (!hash)
+    {
+        for (const EntryType& entry : this->storage->entries)
+        {
+            hash += Json::CombineHash(Json::HashKey(entry.first), entry.second.GetHash());
+        }
+
+        hash = Json::CombineHash(hash, this->storage->entries.size());
+        hash = hash ? hash : ::EMPTY_HASH;
+
+        if (!this->storage->lent.load(std::memory_order_relaxed))
+        {
+            this->storage->hash.store(hash, std::memory_order_relaxed);
+        }
+    }
+
+    return hash;
 }
 
 size_t Json::Dict::Size() const
 {
-    return this->values.size();
+    return this->storage ? this->storage->entries.size() : 0;
 }
 
-void Json::Dict::Set(std::wstring&& key, Value&& value)
+void Json::Dict::Set(std::wstring_view key, Value&& value)
 {
-    if (value.IsUnset())
+    this->Set(Key(key), std::move(value));
+}
+
+void Json::Dict::Set(const Key& key, Value&& value)
+{
+    this->SetEntry(key, std::move(value));
+}
+
+// Nested dicts and vectors are changed where they are, the old contents aren't copied unless they're shared
+Json::Dict& Json::Dict::GetOrCreateDict(std::wstring_view key)
+{
+    return this->GetOrCreateDict(Key(key));
+}
+
+Json::Dict& Json::Dict::GetOrCreateDict(const Key& key)
+{
+    size_t i = this->FindEntry(key);
+    if (i == std::wstring::npos || !this->storage->entries[i].second.IsDict())
+    {
+        i = this->SetEntry(key, Value(Dict()));
+    }
+
+    return this->LendEntry(i).MutableDict();
+}
+
+std::pmr::vector<Json::Value>& Json::Dict::GetOrCreateVector(std::wstring_view key)
+{
+    return this->GetOrCreateVector(Key(key));
+}
+
+std::pmr::vector<Json::Value>& Json::Dict::GetOrCreateVector(const Key& key)
+{
+    size_t i = this->FindEntry(key);
+    if (i == std::wstring::npos || !this->storage->entries[i].second.IsVector())
+    {
+        i = this->SetEntry(key, Value(std::pmr::vector<Value>()));
+    }
+
+    return this->LendEntry(i).MutableVector();
+}
+
+// Like Set, but returns the stored value so that it can be filled in place.
+// An unset value removes the key like Set does, then there's nothing stored to return.
+Json::Value& Json::Dict::Insert(const Key& key, Value&& value)
+{
+    size_t i = this->SetEntry(key, std::move(value));
+    if (i == std::wstring::npos)
     {
-        this->values.erase(key);
-        return;
+        static thread_local Value unsetValue;
+        unsetValue = Value();
+        return unsetValue;
     }
 
-    auto i = this->values.find(key);
-    if (i == this->values.end())
+    return this->LendEntry(i);
+}
+
+Json::Value Json::Dict::Take(std::wstring_view key)
+{
+    return this->Take(Key(key));
+}
+
+// Removes the value and moves it out, nothing is copied or released
+Json::Value Json::Dict::Take(const Key& key)
+{
+    size_t i = this->FindEntry(key);
+    if (i == std::wstring::npos)
     {
-        this->values.emplace(std::move(key), std::move(value));
+        return Value();
+    }
+
+    this->MakeWritable();
+    Value value = std::move(this->storage->entries[i].second);
+    this->SetEntry(key, Value());
+
+    return value;
+}
+
+void Json::Dict::Clear()
+{
+    if (this->storage && this->storage.use_count() == 1)
+    {
+        this->storage->entries.clear();
+        this->storage->index.clear();
+        this->storage->hash.store(0, std::memory_order_relaxed);
+        this->storage->lent.store(false, std::memory_order_relaxed);
     }
     else
     {
-        i->second = std::move(value);
+        this->storage.reset();
+    }
+}
+
+// The entries and the index are allocated once at their final size, growing them would leave copies behind in an arena
+void Json::Dict::Reserve(size_t count)
+{
+    // Any reference that was handed out is no good after this
+    this->MakeWritable();
+    this->storage->lent.store(false, std::memory_order_relaxed);
+    this->storage->entries.reserve(count);
+
+    if (count > ::INDEX_THRESHOLD && this->storage->index.size() < ::GetIndexSize(count))
+    {
+        this->RebuildIndex(count);
+    }
+}
+
+// Returns the entry's index, or npos when it was removed
+size_t Json::Dict::SetEntry(const Key& key, Value&& value)
+{
+    size_t i = this->FindEntry(key);
+    if (i == std::wstring::npos && value.IsUnset())
+    {
+        return std::wstring::npos;
+    }
+
+    // Any reference that was handed out is no good after this
+    this->MakeWritable();
+    this->storage->lent.store(false, std::memory_order_relaxed);
+    EntriesType& entries = this->storage->entries;
+
+    if (value.IsUnset())
+    {
+        entries.erase(entries.begin() + i);
+        this->RebuildIndex(entries.size());
+        return std::wstring::npos;
+    }
+
+    if (i != std::wstring::npos)
+    {
+        entries[i].second = std::move(value);
+        return i;
+    }
+
+    entries.emplace_back(key.GetName(), std::move(value));
+
+    // A reserved index is there before the entries need it
+    if (entries.size() > ::INDEX_THRESHOLD || !this->storage->index.empty())
+    {
+        if (this->storage->index.size() < entries.size() * 2)
+        {
+            this->RebuildIndex(entries.size());
+        }
+        else
+        {
+            this->AddToIndex(key.GetHash(), entries.size());
+        }
     }
+
+    return entries.size() - 1;
 }
 
-Json::Value Json::Dict::Get(const std::wstring& key) const
+// Changes to the value can't clear this Dict's hash, so it's not remembered until the next direct change
+Json::Value& Json::Dict::LendEntry(size_t i)
+{
+    this->MakeWritable();
+    this->storage->lent.store(true, std::memory_order_relaxed);
+    return this->storage->entries[i].second;
+}
+
+Json::Value Json::Dict::Get(std::wstring_view key) const
 {
     Value value = this->GetFromPath(key);
     if (value.IsUnset())
     {
-        auto i = this->values.find(key);
-        if (i != this->values.end())
+        size_t i = this->FindEntry(key);
+        if (i != std::wstring::npos)
         {
-            value = i->second;
+            value = this->storage->entries[i].second;
         }
     }
 
     return value;
 }
 
-Json::Value Json::Dict::GetFromPath(const std::wstring& path) const
+// Keys are never paths, so there is nothing to parse or hash
+Json::Value Json::Dict::Get(const Key& key) const
 {
-    if (path.empty() || path[0] != L'/')
+    size_t i = this->FindEntry(key);
+    return (i != std::wstring::npos) ? this->storage->entries[i].second : Value();
+}
+
+// Only looks for the key, not a path. The pointer is valid until this Dict changes.
+const Json::Value* Json::Dict::Find(std::wstring_view key) const
+{
+    size_t i = this->FindEntry(key);
+    return (i != std::wstring::npos) ? &this->storage->entries[i].second : nullptr;
+}
+
+const Json::Value* Json::Dict::Find(const Key& key) const
+{
+    size_t i = this->FindEntry(key);
+    return (i != std::wstring::npos) ? &this->storage->entries[i].second : nullptr;
+}
+
+// Small dicts don't need the hash at all
+size_t Json::Dict::FindEntry(std::wstring_view key) const
+{
+    if (!this->storage)
     {
-        return Value();
+        return std::wstring::npos;
+    }
+
+    return this->storage->index.empty() ? this->FindLinear(key) : this->FindIndexed(key, Json::HashKey(key));
+}
+
+size_t Json::Dict::FindEntry(const Key& key) const
+{
+    if (!this->storage)
+    {
+        return std::wstring::npos;
     }
 
-    size_t nextThing = path.find_first_of(L"/[", 1, 2);
-    std::wstring name = path.substr(1, nextThing - ((nextThing != std::wstring::npos) ? 1 : 0));
-    Value value = this->Get(name);
+    return this->storage->index.empty() ? this->FindLinear(key.GetName()) : this->FindIndexed(key.GetName(), key.GetHash());
+}
 
-    for (; !value.IsUnset() && nextThing != std::wstring::npos; nextThing = path.find_first_of(L"/[", nextThing + 1, 2))
+size_t Json::Dict::FindLinear(std::wstring_view key) const
+{
+    const EntriesType& entries = this->storage->entries;
+    for (size_t i = 0; i < entries.size(); i++)
     {
-        if (path[nextThing] == '/')
+        if (entries[i].first == key)
         {
-            if (!value.IsDict())
-            {
-                return Value();
-            }
+            return i;
+        }
+    }
 
-            value = value.GetDict().Get(path.substr(nextThing));
-            break;
+    return std::wstring::npos;
+}
+
+size_t Json::Dict::FindIndexed(std::wstring_view key, size_t hash) const
+{
+    const std::pmr::vector<IndexSlot>& index = this->storage->index;
+    size_t mask = index.size() - 1;
+
+    for (size_t slot = hash & mask; index[slot].entry; slot = (slot + 1) & mask)
+    {
+        const IndexSlot& indexSlot = index[slot];
+        if (indexSlot.hash == hash && this->storage->entries[indexSlot.entry - 1].first == key)
+        {
+            return indexSlot.entry - 1;
         }
-        else // '['
+    }
+
+    return std::wstring::npos;
+}
+
+void Json::Dict::AddToIndex(size_t hash, size_t entry)
+{
+    std::pmr::vector<IndexSlot>& index = this->storage->index;
+    size_t mask = index.size() - 1;
+    size_t slot = hash & mask;
+
+    while (index[slot].entry)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    index[slot] = IndexSlot{ hash, entry };
+}
+
+// The index size is a power of two and stays at most half full.
+// It can be made big enough for more entries than there are yet.
+void Json::Dict::RebuildIndex(size_t count)
+{
+    const EntriesType& entries = this->storage->entries;
+    std::pmr::vector<IndexSlot>& index = this->storage->index;
+    index.clear();
+
+    if (count > ::INDEX_THRESHOLD)
+    {
+        index.resize(::GetIndexSize(count), IndexSlot{ 0, 0 });
+
+        for (size_t i = 0; i < entries.size(); i++)
         {
-            if (!value.IsVector())
-            {
-                return Value();
-            }
-
-            wchar_t* parseEnd = nullptr;
-            size_t index = static_cast<size_t>(wcstoul(path.c_str() + nextThing + 1, &parseEnd, 10));
-            if (*parseEnd != ']' || index >= value.GetVector().size())
-            {
-                return Value();
-            }
-
-            value = value.GetVector()[index];
+            this->AddToIndex(Json::HashKey(entries[i].first), i + 1);
         }
     }
+}
 
-    return value;
+// Copy on write. The entries are copied but values are shared, so nested dicts and
+// vectors that didn't change still aren't copied.
+void Json::Dict::MakeWritable()
+{
+    if (!this->storage)
+    {
+        this->storage = std::make_shared<Storage>(std::pmr::get_default_resource());
+    }
+    else if (this->storage.use_count() > 1)
+    {
+        this->storage = std::make_shared<Storage>(*this->storage);
+    }
+    else
+    {
+        this->storage->hash.store(0, std::memory_order_relaxed);
+    }
+}
+
+Json::Value Json::Dict::GetFromPath(std::wstring_view path) const
+{
+    const Value* value = Path::Find(*this, path);
+    return value ? *value : Value();
 }
 
-Json::Dict::MapType::const_iterator Json::Dict::begin() const
+Json::Dict::EntriesType::const_iterator Json::Dict::begin() const
 {
-    return this->values.begin();
+    return this->storage ? this->storage->entries.begin() : ::EMPTY_ENTRIES.begin();
 }
 
-Json::Dict::MapType::const_iterator Json::Dict::end() const
+Json::Dict::EntriesType::const_iterator Json::Dict::end() const
 {
-    return this->values.end();
+    return this->storage ? this->storage->entries.end() : ::EMPTY_ENTRIES.end();
 }
 
 void Json::Dict::DebugDump() const
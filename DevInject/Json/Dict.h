@@ -1,34 +1,102 @@
 ﻿#pragma once
 
+#include "Json/Arena.h"
+#include "Json/Key.h"
 #include "Json/Value.h"
 
 namespace Json
 {
-    // A JSON object
+    // A JSON object, iterates in insertion order.
+    // Copies share their entries until one of them changes, so copying a big dict is cheap.
     class Dict
     {
     public:
         DEV_INJECT_API Dict();
+        DEV_INJECT_API explicit Dict(const std::shared_ptr<Arena>& arena);
         DEV_INJECT_API Dict(Dict&& rhs);
         DEV_INJECT_API Dict(const Dict& rhs);
 
         DEV_INJECT_API const Dict& operator=(Dict&& rhs);
         DEV_INJECT_API const Dict& operator=(const Dict& rhs);
         DEV_INJECT_API bool operator==(const Dict& rhs) const;
+        DEV_INJECT_API size_t GetHash() const;
 
         DEV_INJECT_API size_t Size() const;
-        DEV_INJECT_API void Set(std::wstring&& key, Value&& value);
-        DEV_INJECT_API Value Get(const std::wstring& key) const;
+        DEV_INJECT_API void Set(std::wstring_view key, Value&& value);
+        DEV_INJECT_API void Set(const Key& key, Value&& value);
+        DEV_INJECT_API Value Get(std::wstring_view key) const;
+        DEV_INJECT_API Value Get(const Key& key) const;
+        DEV_INJECT_API const Value* Find(std::wstring_view key) const;
+        DEV_INJECT_API const Value* Find(const Key& key) const;
 
-        typedef std::unordered_map<std::wstring, Value> MapType;
-        DEV_INJECT_API MapType::const_iterator begin() const;
-        DEV_INJECT_API MapType::const_iterator end() const;
+        // In place changes. The references are good until this Dict changes again. While they
+        // are out, this Dict's hash isn't remembered, since nested values can change under it.
+        DEV_INJECT_API Dict& GetOrCreateDict(std::wstring_view key);
+        DEV_INJECT_API Dict& GetOrCreateDict(const Key& key);
+        DEV_INJECT_API std::pmr::vector<Value>& GetOrCreateVector(std::wstring_view key);
+        DEV_INJECT_API std::pmr::vector<Value>& GetOrCreateVector(const Key& key);
+        // An unset value just removes the key, and the returned value isn't part of the Dict
+        DEV_INJECT_API Value& Insert(const Key& key, Value&& value);
+        DEV_INJECT_API Value Take(std::wstring_view key);
+        DEV_INJECT_API Value Take(const Key& key);
+
+        // Keeps the capacity when the entries aren't shared, for a Dict that gets filled again and again
+        DEV_INJECT_API void Clear();
+
+        // Room for this many entries and their index, for a Dict that gets filled all at once
+        DEV_INJECT_API void Reserve(size_t count);
+
+        template<class... Args>
+        Value& Emplace(const Key& key, Args&&... args)
+        {
+            return this->Insert(key, Value(std::forward<Args>(args)...));
+        }
+
+        typedef std::pair<std::pmr::wstring, Value> EntryType;
+        typedef std::pmr::vector<EntryType> EntriesType;
+        DEV_INJECT_API EntriesType::const_iterator begin() const;
+        DEV_INJECT_API EntriesType::const_iterator end() const;
 
         void DebugDump() const;
 
     private:
-        Value GetFromPath(const std::wstring& path) const;
+        Value GetFromPath(std::wstring_view path) const;
+        size_t FindEntry(std::wstring_view key) const;
+        size_t FindEntry(const Key& key) const;
+        size_t FindLinear(std::wstring_view key) const;
+        size_t FindIndexed(std::wstring_view key, size_t hash) const;
+        size_t SetEntry(const Key& key, Value&& value);
+        Value& LendEntry(size_t i);
+        void AddToIndex(size_t hash, size_t entry);
+        void RebuildIndex(size_t count);
+        void MakeWritable();
+
+        // Open addressing, entry is one based so that zero means an empty slot
+        struct IndexSlot
+        {
+            size_t hash;
+            size_t entry;
+        };
+
+        // Entries stay in insertion order, most messages are small enough to just search them.
+        // Bigger dicts like the environment also get a hash index.
+        struct Storage
+        {
+            Storage(std::pmr::memory_resource* resource);
+            Storage(const Storage& rhs);
+
+            EntriesType entries;
+            std::pmr::vector<IndexSlot> index;
+
+            // Zero until GetHash() is called, then cleared by every change
+            mutable std::atomic<size_t> hash;
+
+            // A reference to a value was handed out, so the hash can't be remembered.
+            // GetHash reads it on storage that other threads share, like the hash itself.
+            std::atomic<bool> lent;
+        };
 
-        MapType values;
+        // Null or empty when there are no entries. Never changed while another Dict shares it.
+        std::shared_ptr<Storage> storage;
     };
 }
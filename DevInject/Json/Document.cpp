@@ -0,0 +1,109 @@
+﻿#include "stdafx.h"
+#include "Json/Document.h"
+
+static const Json::Dict EMPTY_DICT;
+
+Json::Document::Document()
+{
+}
+
+Json::Document::Document(size_t arenaSize)
+    : arena(std::make_shared<Arena>(arenaSize))
+    , root(Json::MakeShared<Dict>(this->arena, this->arena))
+{
+}
+
+Json::Document::Document(Document&& rhs)
+    : arena(std::move(rhs.arena))
+    , root(std::move(rhs.root))
+{
+}
+
+Json::Document& Json::Document::operator=(Document&& rhs)
+{
+    this->root = std::move(rhs.root);
+    this->arena = std::move(rhs.arena);
+    return *this;
+}
+
+Json::Dict& Json::Document::GetRoot()
+{
+    if (!this->root)
+    {
+        this->root = std::make_shared<Dict>();
+    }
+
+    return *this->root;
+}
+
+const Json::Dict& Json::Document::GetRoot() const
+{
+    return this->root ? *this->root : ::EMPTY_DICT;
+}
+
+const std::shared_ptr<Json::Arena>& Json::Document::GetArena() const
+{
+    return this->arena;
+}
+
+// Every node holds the arena, so once the root is gone nothing else can be using it
+bool Json::Document::Recycle()
+{
+    if (!this->arena)
+    {
+        return false;
+    }
+
+    this->root.reset();
+    if (this->arena.use_count() > 1)
+    {
+        this->arena.reset();
+        return false;
+    }
+
+    this->arena->Reset();
+    this->root = Json::MakeShared<Dict>(this->arena, this->arena);
+    return true;
+}
+
+Json::Dict Json::CopyToHeap(const Dict& dict)
+{
+    Dict copy;
+    copy.Reserve(dict.Size());
+
+    for (const Dict::EntryType& i : dict)
+    {
+        copy.Set(i.first, Json::CopyToHeap(i.second));
+    }
+
+    return copy;
+}
+
+// Scalars and short strings are held in the value itself, everything else gets copied
+Json::Value Json::CopyToHeap(const Value& value)
+{
+    if (value.IsDict())
+    {
+        return Value(Json::CopyToHeap(value.GetDict()));
+    }
+
+    if (value.IsVector())
+    {
+        std::pmr::vector<Value> copy;
+        copy.reserve(value.GetVector().size());
+
+        for (const Value& i : value.GetVector())
+        {
+            copy.push_back(Json::CopyToHeap(i));
+        }
+
+        return Value(std::move(copy));
+    }
+
+    if (value.IsString())
+    {
+        return Value(value.GetString());
+    }
+
+    return value;
+}
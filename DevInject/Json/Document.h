@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include "Json/Arena.h"
+#include "Json/Dict.h"
+
+namespace Json
+{
+    // One parsed message. All of its nodes and strings live in one arena, which is freed in
+    // one shot after the document and every Value that was copied out of it are gone.
+    // The arena also holds the parsed text, most strings are just pointers into it.
+    class Document
+    {
+    public:
+        DEV_INJECT_API Document();
+        DEV_INJECT_API explicit Document(size_t arenaSize);
+        DEV_INJECT_API Document(Document&& rhs);
+
+        DEV_INJECT_API Document& operator=(Document&& rhs);
+
+        DEV_INJECT_API Dict& GetRoot();
+        DEV_INJECT_API const Dict& GetRoot() const;
+        DEV_INJECT_API const std::shared_ptr<Arena>& GetArena() const;
+
+        // Starts over with an empty root in the same arena, returns false when something outside
+        // the document still uses the arena and a new document is needed instead
+        DEV_INJECT_API bool Recycle();
+
+    private:
+        std::shared_ptr<Arena> arena;
+        std::shared_ptr<Dict> root;
+    };
+
+    // Copies that use no arena, for values that are kept after their document could be recycled
+    DEV_INJECT_API Dict CopyToHeap(const Dict& dict);
+    DEV_INJECT_API Value CopyToHeap(const Value& value);
+}
@@ -0,0 +1,95 @@
+﻿#include "stdafx.h"
+#include "Json/Binary.h"
+#include "Json/Frame.h"
+#include "Json/Message.h"
+#include "Json/Writer.h"
+
+// The text starts with {"ID": and then the slot, which fits any int
+static const size_t UTF8_ID_OFFSET = 6;
+static const size_t UTF8_ID_SIZE = 11;
+
+// The ID is the first entry, so it's always in the same place
+static const size_t BINARY_ID_INDEX = 0;
+
+namespace Json
+{
+    static std::mutex commandFramesMutex;
+    static std::unordered_map<std::wstring_view, std::unique_ptr<Frame>> commandFrames;
+}
+
+// The ID gets written first with a one digit placeholder, which is then widened into the slot
+Json::Frame::Frame(const Dict& message)
+    : message(message)
+{
+    Dict written;
+    written.Set(Keys::Id, Value(0));
+    for (const auto& i : message)
+    {
+        if (i.first != Keys::Id.GetName())
+        {
+            written.Set(i.first, Value(i.second));
+        }
+    }
+
+    Writer writer;
+    writer.Write(written);
+    std::string_view text = writer.GetUtf8();
+    assert(text.substr(0, ::UTF8_ID_OFFSET + 1) == "{\"ID\":0");
+
+    this->utf8.reserve(text.size() + ::UTF8_ID_SIZE - 1);
+    this->utf8.append(text.substr(0, ::UTF8_ID_OFFSET));
+    this->utf8.append(::UTF8_ID_SIZE, ' ');
+    this->utf8.append(text.substr(::UTF8_ID_OFFSET + 1));
+
+    BinaryWriter binaryWriter;
+    binaryWriter.Write(written);
+    this->binary.assign(binaryWriter.GetData(), binaryWriter.GetData() + binaryWriter.GetSize());
+    assert(BinaryValue::GetRoot(this->binary.data(), this->binary.size()).GetKeyAt(::BINARY_ID_INDEX) == "ID");
+}
+
+const Json::Dict& Json::Frame::GetDict() const
+{
+    return this->message;
+}
+
+size_t Json::Frame::GetUtf8Size() const
+{
+    return this->utf8.size();
+}
+
+// Whitespace is allowed after a number, so the rest of the slot stays as spaces
+void Json::Frame::CopyUtf8(int id, char* buffer) const
+{
+    std::memcpy(buffer, this->utf8.data(), this->utf8.size());
+    std::to_chars(buffer + ::UTF8_ID_OFFSET, buffer + ::UTF8_ID_OFFSET + ::UTF8_ID_SIZE, id);
+}
+
+size_t Json::Frame::GetBinarySize() const
+{
+    return this->binary.size();
+}
+
+void Json::Frame::CopyBinary(int id, BYTE* buffer) const
+{
+    std::memcpy(buffer, this->binary.data(), this->binary.size());
+    std::memcpy(buffer + BinaryWriter::GetRootIntOffset(::BINARY_ID_INDEX), &id, sizeof(id));
+}
+
+// The map's keys point into each frame's own message
+const Json::Frame& Json::GetCommandFrame(std::wstring_view command)
+{
+    std::scoped_lock<std::mutex> lock(Json::commandFramesMutex);
+
+    auto i = Json::commandFrames.find(command);
+    if (i == Json::commandFrames.end())
+    {
+        Dict message;
+        message.Set(Keys::Command, Value(command));
+
+        std::unique_ptr<Frame> frame = std::make_unique<Frame>(message);
+        std::wstring_view key = frame->GetDict().Find(Keys::Command)->GetString();
+        i = Json::commandFrames.emplace(key, std::move(frame)).first;
+    }
+
+    return *i->second;
+}
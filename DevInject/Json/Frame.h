@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include "Json/Dict.h"
+
+namespace Json
+{
+    // A message that is written once, in both the text and the binary format, and then sent many times.
+    // Only the transaction ID changes, it's patched into a copy of the bytes right before each send.
+    // The text has a fixed width slot for the ID that is padded with spaces.
+    class Frame
+    {
+    public:
+        DEV_INJECT_API Frame(const Dict& message);
+
+        // The message as it was passed in, without an ID
+        DEV_INJECT_API const Dict& GetDict() const;
+
+        DEV_INJECT_API size_t GetUtf8Size() const;
+        DEV_INJECT_API void CopyUtf8(int id, char* buffer) const;
+
+        DEV_INJECT_API size_t GetBinarySize() const;
+        DEV_INJECT_API void CopyBinary(int id, BYTE* buffer) const;
+
+    private:
+        Dict message;
+        std::string utf8;
+        std::vector<BYTE> binary;
+    };
+
+    // Frames for commands without properties, like PIPE_COMMAND_ACTIVATED, made on first use and never freed.
+    // This locks, so callers look a frame up once and keep the reference.
+    DEV_INJECT_API const Frame& GetCommandFrame(std::wstring_view command);
+}
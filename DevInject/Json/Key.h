@@ -0,0 +1,55 @@
+﻿#pragma once
+
+namespace Json
+{
+    // FNV-1a, usable at compile time so that well known keys are hashed by the compiler
+    constexpr size_t HashKey(std::wstring_view key)
+    {
+        size_t hash = (sizeof(size_t) == 8) ? static_cast<size_t>(14695981039346656037ULL) : static_cast<size_t>(2166136261U);
+        const size_t prime = (sizeof(size_t) == 8) ? static_cast<size_t>(1099511628211ULL) : static_cast<size_t>(16777619U);
+
+        for (wchar_t ch : key)
+        {
+            hash = (hash ^ static_cast<size_t>(ch)) * prime;
+        }
+
+        return hash;
+    }
+
+    // Mixes one more hash into a running hash, order matters
+    constexpr size_t CombineHash(size_t seed, size_t hash)
+    {
+        return seed ^ (hash + static_cast<size_t>(0x9E3779B97F4A7C15ULL) + (seed << 6) + (seed >> 2));
+    }
+
+    // A Dict key with its hash computed up front. The name isn't copied, so it's meant for string literals.
+    class Key
+    {
+    public:
+        constexpr explicit Key(std::wstring_view name)
+            : name(name)
+            , hash(Json::HashKey(name))
+        {
+        }
+
+        constexpr Key(std::wstring_view name, size_t hash)
+            : name(name)
+            , hash(hash)
+        {
+        }
+
+        constexpr std::wstring_view GetName() const
+        {
+            return this->name;
+        }
+
+        constexpr size_t GetHash() const
+        {
+            return this->hash;
+        }
+
+    private:
+        std::wstring_view name;
+        size_t hash;
+    };
+}
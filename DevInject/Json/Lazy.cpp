@@ -0,0 +1,28 @@
+﻿#include "stdafx.h"
+#include "Json/Lazy.h"
+
+Json::LazyValue::LazyValue(std::shared_ptr<const wchar_t>&& text, size_t length, const ParseLimits& limits)
+    : text(std::move(text))
+    , length(length)
+    , limits(limits)
+    , dict(length && this->text.get()[0] == L'{')
+{
+}
+
+bool Json::LazyValue::IsDict() const
+{
+    return this->dict;
+}
+
+// The text was checked with the same limits when it was skipped, so it can't fail to parse now
+const Json::Value& Json::LazyValue::Get() const
+{
+    std::call_once(this->parsed, [this]()
+    {
+        size_t errorPos;
+        this->value = Json::ParseValue(this->text.get(), this->length, &errorPos, this->limits);
+        assert(errorPos == std::wstring::npos);
+    });
+
+    return this->value;
+}
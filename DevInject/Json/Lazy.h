@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include "Json/Persist.h"
+
+namespace Json
+{
+    // A nested object or array from ParseDocumentLazy that stays as text until it's first looked at.
+    // It gets parsed onto the heap, not the document's arena, so more than one thread can read the same document.
+    class LazyValue
+    {
+    public:
+        DEV_INJECT_API LazyValue(std::shared_ptr<const wchar_t>&& text, size_t length, const ParseLimits& limits);
+
+        DEV_INJECT_API bool IsDict() const;
+        DEV_INJECT_API const Value& Get() const;
+
+    private:
+        std::shared_ptr<const wchar_t> text;
+        size_t length;
+        ParseLimits limits;
+        bool dict;
+        mutable std::once_flag parsed;
+        mutable Value value;
+    };
+}
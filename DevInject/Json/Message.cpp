@@ -4,13 +4,13 @@
 Json::Dict Json::CreateMessage(std::wstring&& commandName)
 {
     Dict dict;
-    dict.Set(PIPE_PROPERTY_COMMAND, Value(std::move(commandName)));
+    dict.Set(Keys::Command, Value(std::move(commandName)));
     return dict;
 }
 
 Json::Dict Json::CallMessageHandler(const MessageHandlers& handlers, const Dict& dict)
 {
-    Value command = dict.Get(PIPE_PROPERTY_COMMAND);
+    Value command = dict.Get(Keys::Command);
     if (command.IsString())
     {
         auto i = handlers.find(command.GetString());
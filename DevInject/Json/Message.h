@@ -21,6 +21,8 @@
 #define PIPE_PROPERTY_COMMAND L"Command"
 #define PIPE_PROPERTY_DIRECTORY L"Directory"
 #define PIPE_PROPERTY_ENVIRONMENT L"Environment"
+#define PIPE_PROPERTY_ENVIRONMENT_PATCH L"EnvironmentPatch"
+#define PIPE_PROPERTY_ENVIRONMENT_VERSION L"EnvironmentVersion"
 #define PIPE_PROPERTY_EXECUTABLE L"Executable"
 #define PIPE_PROPERTY_HWND L"HWND"
 #define PIPE_PROPERTY_ID L"ID"
@@ -28,8 +30,26 @@
 
 namespace Json
 {
+    // Property names hashed at compile time, for lookups on the message hot path
+    namespace Keys
+    {
+        constexpr Key Aliases(PIPE_PROPERTY_ALIASES);
+        constexpr Key Arguments(PIPE_PROPERTY_ARGUMENTS);
+        constexpr Key Colors(PIPE_PROPERTY_COLORS);
+        constexpr Key Command(PIPE_PROPERTY_COMMAND);
+        constexpr Key Directory(PIPE_PROPERTY_DIRECTORY);
+        constexpr Key Environment(PIPE_PROPERTY_ENVIRONMENT);
+        constexpr Key EnvironmentPatch(PIPE_PROPERTY_ENVIRONMENT_PATCH);
+        constexpr Key EnvironmentVersion(PIPE_PROPERTY_ENVIRONMENT_VERSION);
+        constexpr Key Executable(PIPE_PROPERTY_EXECUTABLE);
+        constexpr Key Hwnd(PIPE_PROPERTY_HWND);
+        constexpr Key Id(PIPE_PROPERTY_ID);
+        constexpr Key Title(PIPE_PROPERTY_TITLE);
+    }
+
+    // Command names must be string literals like the PIPE_COMMAND values, since they aren't copied
     typedef std::function<Dict(const Dict& dict)> MessageHandler;
-    typedef std::unordered_map<std::wstring, MessageHandler> MessageHandlers;
+    typedef std::unordered_map<std::wstring_view, MessageHandler> MessageHandlers;
 
     DEV_INJECT_API Dict CreateMessage(std::wstring&& commandName);
     DEV_INJECT_API Dict CallMessageHandler(const MessageHandlers& handlers, const Dict& dict);
@@ -0,0 +1,59 @@
+﻿#include "stdafx.h"
+#include "Json/Patch.h"
+
+// Only keys that changed end up in the patch, nested dicts are diffed instead of sent whole
+Json::Dict Json::Diff(const Dict& oldDict, const Dict& newDict)
+{
+    Dict patch;
+
+    for (const auto& i : oldDict)
+    {
+        if (!newDict.Find(i.first))
+        {
+            patch.Set(i.first, Value(nullptr));
+        }
+    }
+
+    for (const auto& i : newDict)
+    {
+        const Value* oldValue = oldDict.Find(i.first);
+        if (!oldValue)
+        {
+            patch.Set(i.first, Value(i.second));
+        }
+        else if (oldValue->IsDict() && i.second.IsDict())
+        {
+            Dict nestedPatch = Json::Diff(oldValue->GetDict(), i.second.GetDict());
+            if (nestedPatch.Size())
+            {
+                patch.Set(i.first, Value(std::move(nestedPatch)));
+            }
+        }
+        else if (!(*oldValue == i.second))
+        {
+            patch.Set(i.first, Value(i.second));
+        }
+    }
+
+    return patch;
+}
+
+// Copies of the dict don't see the change, only the nested dicts on the patched paths get copied
+void Json::Apply(Dict& dict, const Dict& patch)
+{
+    for (const auto& i : patch)
+    {
+        if (i.second.IsNull())
+        {
+            dict.Set(i.first, Value());
+        }
+        else if (i.second.IsDict())
+        {
+            Json::Apply(dict.GetOrCreateDict(i.first), i.second.GetDict());
+        }
+        else
+        {
+            dict.Set(i.first, Value(i.second));
+        }
+    }
+}
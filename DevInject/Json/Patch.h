@@ -0,0 +1,11 @@
+﻿#pragma once
+
+#include "Json/Dict.h"
+
+namespace Json
+{
+    // JSON merge patches (RFC 7396). A key in the patch replaces the key in the target, null removes it,
+    // and a dict patches the dict that is already there. So nothing can be changed to null with a patch.
+    DEV_INJECT_API Dict Diff(const Dict& oldDict, const Dict& newDict);
+    DEV_INJECT_API void Apply(Dict& dict, const Dict& patch);
+}
@@ -0,0 +1,120 @@
+﻿#include "stdafx.h"
+#include "Json/Path.h"
+
+Json::Path::Path(std::wstring_view path)
+    : text(path)
+    , valid(!path.empty() && path[0] == L'/')
+{
+    Segment segment;
+    for (size_t pos = 0; this->valid && pos < this->text.size(); )
+    {
+        this->valid = Json::Path::ParseSegment(this->text, pos, segment);
+        this->segments.push_back(segment);
+    }
+}
+
+bool Json::Path::IsValid() const
+{
+    return this->valid;
+}
+
+const Json::Value* Json::Path::Find(const Dict& dict) const
+{
+    const Value* value = nullptr;
+
+    if (this->valid)
+    {
+        for (const Segment& segment : this->segments)
+        {
+            value = Json::Path::FindSegment(value ? nullptr : &dict, value, this->text, segment);
+            if (!value)
+            {
+                break;
+            }
+        }
+    }
+
+    return value;
+}
+
+const Json::Value* Json::Path::Find(const Dict& dict, std::wstring_view path)
+{
+    if (path.empty() || path[0] != L'/')
+    {
+        return nullptr;
+    }
+
+    const Value* value = nullptr;
+    Segment segment;
+
+    for (size_t pos = 0; pos < path.size(); )
+    {
+        if (!Json::Path::ParseSegment(path, pos, segment))
+        {
+            return nullptr;
+        }
+
+        value = Json::Path::FindSegment(value ? nullptr : &dict, value, path, segment);
+        if (!value)
+        {
+            break;
+        }
+    }
+
+    return value;
+}
+
+bool Json::Path::ParseSegment(std::wstring_view path, size_t& pos, Segment& segment)
+{
+    segment.bracket = (path[pos] == L'[');
+    segment.start = pos + 1;
+
+    size_t end = segment.bracket ? path.find(L']', segment.start) : path.find_first_of(L"/[", segment.start);
+    if (end == std::wstring::npos)
+    {
+        if (segment.bracket)
+        {
+            return false;
+        }
+
+        end = path.size();
+    }
+
+    segment.length = end - segment.start;
+    segment.hash = Json::HashKey(path.substr(segment.start, segment.length));
+    segment.index = segment.length ? 0 : std::wstring::npos;
+
+    for (size_t i = segment.start; i < end && segment.index != std::wstring::npos; i++)
+    {
+        segment.index = (path[i] >= L'0' && path[i] <= L'9') ? segment.index * 10 + (path[i] - L'0') : std::wstring::npos;
+    }
+
+    if (segment.bracket && segment.index == std::wstring::npos)
+    {
+        return false;
+    }
+
+    pos = segment.bracket ? end + 1 : end;
+    return true;
+}
+
+// Looks in the root dict for the first segment, then in the value found by the previous segment
+const Json::Value* Json::Path::FindSegment(const Dict* dict, const Value* value, std::wstring_view path, const Segment& segment)
+{
+    if (!dict && !segment.bracket && value->IsDict())
+    {
+        dict = &value->GetDict();
+    }
+
+    if (dict)
+    {
+        return !segment.bracket ? dict->Find(Key(path.substr(segment.start, segment.length), segment.hash)) : nullptr;
+    }
+
+    if (value->IsVector() && segment.index < value->GetVector().size())
+    {
+        return &value->GetVector()[segment.index];
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "Json/Dict.h"
+
+namespace Json
+{
+    // A path like /Aliases/cmd.exe/ls or /Values[3] that is parsed once and can then be
+    // looked up many times without allocating. Returns pointers into the Dict, so they're
+    // only valid while that Dict is alive and unchanged.
+    class Path
+    {
+    public:
+        DEV_INJECT_API explicit Path(std::wstring_view path);
+
+        DEV_INJECT_API bool IsValid() const;
+        DEV_INJECT_API const Value* Find(const Dict& dict) const;
+
+        // For a one time lookup, nothing gets compiled or allocated
+        DEV_INJECT_API static const Value* Find(const Dict& dict, std::wstring_view path);
+
+    private:
+        // A /name or [index], index is npos when the name isn't a number
+        struct Segment
+        {
+            size_t start;
+            size_t length;
+            size_t hash;
+            size_t index;
+            bool bracket;
+        };
+
+        static bool ParseSegment(std::wstring_view path, size_t& pos, Segment& segment);
+        static const Value* FindSegment(const Dict* dict, const Value* value, std::wstring_view path, const Segment& segment);
+
+        std::wstring text;
+        std::vector<Segment> segments;
+        bool valid;
+    };
+}
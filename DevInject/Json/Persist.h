@@ -1,12 +1,46 @@
 ﻿#pragma once
 
 #include "Json/Dict.h"
+#include "Json/Document.h"
 
 namespace Json
 {
-    DEV_INJECT_API Dict Parse(const wchar_t* text, size_t len = 0, size_t * errorPos = nullptr);
+    // Text can come from another process, so parsing stops with an error when it goes past these.
+    // The defaults are far above any real message.
+    struct ParseLimits
+    {
+        DEV_INJECT_API ParseLimits();
+
+        size_t maxDepth;
+        size_t maxStringLength;
+        size_t maxNodes;
+
+        // Bytes of one message that is fed in chunks, text or binary
+        size_t maxMessageSize;
+    };
+
+    DEV_INJECT_API Dict Parse(const wchar_t* text, size_t len = 0, size_t * errorPos = nullptr, const ParseLimits& limits = ParseLimits());
+    DEV_INJECT_API Document ParseDocument(const wchar_t* text, size_t len = 0, size_t* errorPos = nullptr, const ParseLimits& limits = ParseLimits());
     DEV_INJECT_API std::wstring Write(const Dict& dict);
 
+    // Only the top level gets parsed, nested objects and arrays are parsed the first time they're used
+    DEV_INJECT_API Document ParseDocumentLazy(const wchar_t* text, size_t len = 0, size_t* errorPos = nullptr, const ParseLimits& limits = ParseLimits());
+
+    // The text is one object or array
+    DEV_INJECT_API Value ParseValue(const wchar_t* text, size_t len = 0, size_t* errorPos = nullptr, const ParseLimits& limits = ParseLimits());
+
+    // UTF-8 text, errorPos is a byte offset
+    DEV_INJECT_API Dict ParseUtf8(const char* text, size_t len = 0, size_t* errorPos = nullptr, const ParseLimits& limits = ParseLimits());
+    DEV_INJECT_API Document ParseDocumentUtf8(const char* text, size_t len = 0, size_t* errorPos = nullptr, const ParseLimits& limits = ParseLimits());
+    DEV_INJECT_API std::string WriteUtf8(const Dict& dict);
+
+    // Maps a whole file read only, it's unmapped when the last pointer goes away. Null when it can't be mapped.
+    DEV_INJECT_API std::shared_ptr<const BYTE> MapFile(const wchar_t* path, size_t& size);
+
+    // UTF-8 or UTF-16 with or without a BOM, errorPos is a byte offset into the file.
+    // UTF-16 text is parsed right out of the mapping, which the document keeps alive.
+    DEV_INJECT_API Document ParseFile(const wchar_t* path, size_t* errorPos = nullptr, const ParseLimits& limits = ParseLimits());
+
     DEV_INJECT_API Dict ParseNameValuePairs(const wchar_t* text, wchar_t separator);
     DEV_INJECT_API std::wstring WriteNameValuePairs(const Dict& dict, wchar_t separator);
 }
@@ -0,0 +1,209 @@
+﻿#include "stdafx.h"
+#include "Json/Reader.h"
+
+Json::Reader::Reader(const wchar_t* text, size_t len)
+    : tokenizer(text ? text : L"", (text && !len) ? std::wcslen(text) : len)
+    , token{ TokenType::None, text, 0 }
+    , event(ReaderEvent::None)
+    , text(text ? text : L"")
+    , errorPos(nullptr)
+    , rootDone(false)
+{
+}
+
+Json::ReaderEvent Json::Reader::Next()
+{
+    if (this->event == ReaderEvent::Error)
+    {
+        return this->event;
+    }
+
+    this->token = this->tokenizer.NextToken();
+
+    if (this->stack.empty())
+    {
+        if (!this->rootDone)
+        {
+            return this->StartValue(this->token);
+        }
+
+        // Only one root value is allowed
+        return (this->token.type == TokenType::None)
+            ? (this->event = ReaderEvent::None)
+            : this->SetError(this->token);
+    }
+
+    Frame& frame = this->stack.back();
+    switch (frame.state)
+    {
+    case State::KeyOrEnd:
+        if (this->token.type == TokenType::CloseCurly)
+        {
+            return this->EndContainer(true);
+        }
+
+        if (this->token.type == TokenType::String)
+        {
+            frame.state = State::Colon;
+            return (this->event = ReaderEvent::Key);
+        }
+        break;
+
+    case State::Colon:
+        if (this->token.type == TokenType::Colon)
+        {
+            frame.state = State::CommaOrEnd;
+            this->token = this->tokenizer.NextToken();
+            return this->StartValue(this->token);
+        }
+        break;
+
+    case State::ValueOrEnd:
+        if (this->token.type == TokenType::CloseBracket)
+        {
+            return this->EndContainer(false);
+        }
+
+        frame.state = State::CommaOrEnd;
+        return this->StartValue(this->token);
+
+    case State::CommaOrEnd:
+        if (this->token.type == TokenType::Comma)
+        {
+            // A trailing comma before the end is allowed, just like Json::Parse
+            frame.state = frame.object ? State::KeyOrEnd : State::ValueOrEnd;
+            this->event = ReaderEvent::None;
+            return this->Next();
+        }
+
+        if (this->token.type == (frame.object ? TokenType::CloseCurly : TokenType::CloseBracket))
+        {
+            return this->EndContainer(frame.object);
+        }
+        break;
+    }
+
+    return this->SetError(this->token);
+}
+
+// Skips the rest of the value that started with the current event. For a Key event, that's the key's value.
+bool Json::Reader::Skip()
+{
+    if (this->event == ReaderEvent::Key)
+    {
+        this->Next();
+    }
+
+    if (this->event == ReaderEvent::BeginObject || this->event == ReaderEvent::BeginArray)
+    {
+        for (size_t depth = this->stack.size(); this->stack.size() >= depth; )
+        {
+            if (this->Next() == ReaderEvent::Error)
+            {
+                break;
+            }
+        }
+    }
+
+    return this->event != ReaderEvent::Error;
+}
+
+Json::ReaderEvent Json::Reader::GetEvent() const
+{
+    return this->event;
+}
+
+size_t Json::Reader::GetDepth() const
+{
+    return this->stack.size();
+}
+
+size_t Json::Reader::GetErrorPos() const
+{
+    return this->errorPos ? (this->errorPos - this->text) : std::wstring::npos;
+}
+
+bool Json::Reader::KeyEquals(std::wstring_view name) const
+{
+    if (this->event != ReaderEvent::Key)
+    {
+        return false;
+    }
+
+    std::wstring_view raw(this->token.start + 1, this->token.length - 2);
+    if (raw.find(L'\\') == std::wstring_view::npos)
+    {
+        return raw == name;
+    }
+
+    Value key = this->token.GetValue();
+    return key.IsString() && key.GetString() == name;
+}
+
+// Returns the current key or scalar value, containers are not built
+Json::Value Json::Reader::GetValue() const
+{
+    switch (this->event)
+    {
+    case ReaderEvent::Key:
+    case ReaderEvent::String:
+    case ReaderEvent::Number:
+    case ReaderEvent::Bool:
+    case ReaderEvent::Null:
+        return this->token.GetValue();
+
+    default:
+        return Value();
+    }
+}
+
+Json::ReaderEvent Json::Reader::StartValue(const Token& token)
+{
+    switch (token.type)
+    {
+    case TokenType::OpenCurly:
+        this->stack.push_back(Frame{ true, State::KeyOrEnd });
+        return (this->event = ReaderEvent::BeginObject);
+
+    case TokenType::OpenBracket:
+        this->stack.push_back(Frame{ false, State::ValueOrEnd });
+        return (this->event = ReaderEvent::BeginArray);
+
+    case TokenType::String:
+        this->event = ReaderEvent::String;
+        break;
+
+    case TokenType::Number:
+        this->event = ReaderEvent::Number;
+        break;
+
+    case TokenType::True:
+    case TokenType::False:
+        this->event = ReaderEvent::Bool;
+        break;
+
+    case TokenType::Null:
+        this->event = ReaderEvent::Null;
+        break;
+
+    default:
+        return this->SetError(token);
+    }
+
+    this->rootDone = this->stack.empty();
+    return this->event;
+}
+
+Json::ReaderEvent Json::Reader::EndContainer(bool object)
+{
+    this->stack.pop_back();
+    this->rootDone = this->stack.empty();
+
+    return (this->event = object ? ReaderEvent::EndObject : ReaderEvent::EndArray);
+}
+
+Json::ReaderEvent Json::Reader::SetError(const Token& token)
+{
+    this->errorPos = token.start;
+    return (this->event = ReaderEvent::Error);
+}
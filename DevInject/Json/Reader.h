@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include "Json/Tokenizer.h"
+
+namespace Json
+{
+    enum class ReaderEvent
+    {
+        None,
+        Error,
+        BeginObject,
+        EndObject,
+        BeginArray,
+        EndArray,
+        Key,
+        String,
+        Number,
+        Bool,
+        Null,
+    };
+
+    // Pull parser that returns one JSON event at a time without building a Dict.
+    // Callers read the values they care about and Skip() everything else.
+    class Reader
+    {
+    public:
+        DEV_INJECT_API Reader(const wchar_t* text, size_t len = 0);
+
+        DEV_INJECT_API ReaderEvent Next();
+        DEV_INJECT_API bool Skip();
+
+        DEV_INJECT_API ReaderEvent GetEvent() const;
+        DEV_INJECT_API size_t GetDepth() const;
+        DEV_INJECT_API size_t GetErrorPos() const;
+        DEV_INJECT_API bool KeyEquals(std::wstring_view name) const;
+        DEV_INJECT_API Value GetValue() const;
+
+    private:
+        enum class State
+        {
+            KeyOrEnd,
+            Colon,
+            ValueOrEnd,
+            CommaOrEnd,
+        };
+
+        struct Frame
+        {
+            bool object;
+            State state;
+        };
+
+        ReaderEvent StartValue(const Token& token);
+        ReaderEvent EndContainer(bool object);
+        ReaderEvent SetError(const Token& token);
+
+        Tokenizer tokenizer;
+        Token token;
+        ReaderEvent event;
+        const wchar_t* text;
+        const wchar_t* errorPos;
+        bool rootDone;
+        std::vector<Frame> stack;
+    };
+}
@@ -0,0 +1,222 @@
+﻿#include "stdafx.h"
+#include "Json/Scan.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#define JSON_SCAN_SIMD
+static_assert(sizeof(wchar_t) == 2, "SIMD scanning expects UTF-16 wchar_t");
+#endif
+
+namespace Json
+{
+    // Each matcher knows which chars stop a scan, one char at a time or a whole vector at a time
+
+    struct StringCharsMatcher
+    {
+        static bool Stop(wchar_t ch)
+        {
+            return ch == '\"' || ch == '\\' || ch < ' ';
+        }
+
+#ifdef JSON_SCAN_SIMD
+        static __m128i Stop(__m128i chars)
+        {
+            __m128i control = _mm_cmpeq_epi16(_mm_and_si128(chars, _mm_set1_epi16(static_cast<short>(0xFFE0))), _mm_setzero_si128());
+            __m128i quote = _mm_cmpeq_epi16(chars, _mm_set1_epi16('\"'));
+            __m128i backslash = _mm_cmpeq_epi16(chars, _mm_set1_epi16('\\'));
+            return _mm_or_si128(control, _mm_or_si128(quote, backslash));
+        }
+
+        static __m256i Stop(__m256i chars)
+        {
+            __m256i control = _mm256_cmpeq_epi16(_mm256_and_si256(chars, _mm256_set1_epi16(static_cast<short>(0xFFE0))), _mm256_setzero_si256());
+            __m256i quote = _mm256_cmpeq_epi16(chars, _mm256_set1_epi16('\"'));
+            __m256i backslash = _mm256_cmpeq_epi16(chars, _mm256_set1_epi16('\\'));
+            return _mm256_or_si256(control, _mm256_or_si256(quote, backslash));
+        }
+#endif
+    };
+
+    struct SpacesMatcher
+    {
+        static bool Stop(wchar_t ch)
+        {
+            return ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n';
+        }
+
+#ifdef JSON_SCAN_SIMD
+        static __m128i Stop(__m128i chars)
+        {
+            __m128i spaces = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi16(chars, _mm_set1_epi16(' ')), _mm_cmpeq_epi16(chars, _mm_set1_epi16('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi16(chars, _mm_set1_epi16('\r')), _mm_cmpeq_epi16(chars, _mm_set1_epi16('\n'))));
+            return _mm_xor_si128(spaces, _mm_set1_epi16(-1));
+        }
+
+        static __m256i Stop(__m256i chars)
+        {
+            __m256i spaces = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi16(chars, _mm256_set1_epi16(' ')), _mm256_cmpeq_epi16(chars, _mm256_set1_epi16('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi16(chars, _mm256_set1_epi16('\r')), _mm256_cmpeq_epi16(chars, _mm256_set1_epi16('\n'))));
+            return _mm256_xor_si256(spaces, _mm256_set1_epi16(-1));
+        }
+#endif
+    };
+
+    struct DigitsMatcher
+    {
+        static bool Stop(wchar_t ch)
+        {
+            return ch < '0' || ch > '9';
+        }
+
+#ifdef JSON_SCAN_SIMD
+        static __m128i Stop(__m128i chars)
+        {
+            // Unsigned saturation: both differences are zero only for '0' through '9'
+            __m128i notAbove = _mm_cmpeq_epi16(_mm_subs_epu16(chars, _mm_set1_epi16('9')), _mm_setzero_si128());
+            __m128i notBelow = _mm_cmpeq_epi16(_mm_subs_epu16(_mm_set1_epi16('0'), chars), _mm_setzero_si128());
+            return _mm_xor_si128(_mm_and_si128(notAbove, notBelow), _mm_set1_epi16(-1));
+        }
+
+        static __m256i Stop(__m256i chars)
+        {
+            __m256i notAbove = _mm256_cmpeq_epi16(_mm256_subs_epu16(chars, _mm256_set1_epi16('9')), _mm256_setzero_si256());
+            __m256i notBelow = _mm256_cmpeq_epi16(_mm256_subs_epu16(_mm256_set1_epi16('0'), chars), _mm256_setzero_si256());
+            return _mm256_xor_si256(_mm256_and_si256(notAbove, notBelow), _mm256_set1_epi16(-1));
+        }
+#endif
+    };
+
+    template<class Matcher>
+    static const wchar_t* ScanScalar(const wchar_t* pos, const wchar_t* end)
+    {
+        while (pos != end && !Matcher::Stop(*pos))
+        {
+            pos++;
+        }
+
+        return pos;
+    }
+
+#ifdef JSON_SCAN_SIMD
+    static unsigned long FirstBit(unsigned long mask)
+    {
+        unsigned long index = 0;
+        ::_BitScanForward(&index, mask);
+        return index;
+    }
+
+    // 8 chars per step
+    template<class Matcher>
+    static const wchar_t* ScanSse2(const wchar_t* pos, const wchar_t* end)
+    {
+        for (; end - pos >= 8; pos += 8)
+        {
+            __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            unsigned long mask = static_cast<unsigned long>(_mm_movemask_epi8(Matcher::Stop(chars)));
+            if (mask)
+            {
+                // Two mask bits per char
+                return pos + Json::FirstBit(mask) / 2;
+            }
+        }
+
+        return Json::ScanScalar<Matcher>(pos, end);
+    }
+
+    // 16 chars per step, the tail goes through SSE2
+    template<class Matcher>
+    static const wchar_t* ScanAvx2(const wchar_t* pos, const wchar_t* end)
+    {
+        for (; end - pos >= 16; pos += 16)
+        {
+            __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+            unsigned long mask = static_cast<unsigned long>(_mm256_movemask_epi8(Matcher::Stop(chars)));
+            if (mask)
+            {
+                _mm256_zeroupper();
+                return pos + Json::FirstBit(mask) / 2;
+            }
+        }
+
+        _mm256_zeroupper();
+        return Json::ScanSse2<Matcher>(pos, end);
+    }
+
+    static bool HasAvx2()
+    {
+        int info[4]{};
+        ::__cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // The OS must also save the YMM registers
+        ::__cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (::_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        ::__cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+#endif
+
+    static ScanFunctions ChooseScanFunctions()
+    {
+#ifdef JSON_SCAN_SIMD
+        if (Json::HasAvx2())
+        {
+            return ScanFunctions{ Json::ScanAvx2<StringCharsMatcher>, Json::ScanAvx2<SpacesMatcher>, Json::ScanAvx2<DigitsMatcher> };
+        }
+
+        return ScanFunctions{ Json::ScanSse2<StringCharsMatcher>, Json::ScanSse2<SpacesMatcher>, Json::ScanSse2<DigitsMatcher> };
+#else
+        return ScanFunctions{ Json::ScanScalar<StringCharsMatcher>, Json::ScanScalar<SpacesMatcher>, Json::ScanScalar<DigitsMatcher> };
+#endif
+    }
+}
+
+// Picked once, the first time anything gets tokenized
+static const Json::ScanFunctions& GetScanFunctions()
+{
+    static const Json::ScanFunctions functions = Json::ChooseScanFunctions();
+    return functions;
+}
+
+const wchar_t* Json::ScanStringChars(const wchar_t* pos, const wchar_t* end)
+{
+    return ::GetScanFunctions().stringChars(pos, end);
+}
+
+const wchar_t* Json::ScanSpaces(const wchar_t* pos, const wchar_t* end)
+{
+    return ::GetScanFunctions().spaces(pos, end);
+}
+
+const wchar_t* Json::ScanDigits(const wchar_t* pos, const wchar_t* end)
+{
+    return ::GetScanFunctions().digits(pos, end);
+}
+
+std::vector<Json::ScanFunctions> Json::GetAllScanFunctions()
+{
+    std::vector<ScanFunctions> functions;
+    functions.push_back(ScanFunctions{ Json::ScanScalar<StringCharsMatcher>, Json::ScanScalar<SpacesMatcher>, Json::ScanScalar<DigitsMatcher> });
+
+#ifdef JSON_SCAN_SIMD
+    functions.push_back(ScanFunctions{ Json::ScanSse2<StringCharsMatcher>, Json::ScanSse2<SpacesMatcher>, Json::ScanSse2<DigitsMatcher> });
+
+    if (Json::HasAvx2())
+    {
+        functions.push_back(ScanFunctions{ Json::ScanAvx2<StringCharsMatcher>, Json::ScanAvx2<SpacesMatcher>, Json::ScanAvx2<DigitsMatcher> });
+    }
+#endif
+
+    return functions;
+}
@@ -0,0 +1,21 @@
+﻿#pragma once
+
+namespace Json
+{
+    // Vectorized scanning for the tokenizer, each returns the first char in [pos, end) that stops the scan
+    const wchar_t* ScanStringChars(const wchar_t* pos, const wchar_t* end); // stops at quote, backslash, or control char
+    const wchar_t* ScanSpaces(const wchar_t* pos, const wchar_t* end); // skips ASCII JSON whitespace
+    const wchar_t* ScanDigits(const wchar_t* pos, const wchar_t* end); // skips ASCII digits
+
+    typedef const wchar_t* (*ScanFunction)(const wchar_t* pos, const wchar_t* end);
+
+    struct ScanFunctions
+    {
+        ScanFunction stringChars;
+        ScanFunction spaces;
+        ScanFunction digits;
+    };
+
+    // Every implementation this CPU can run, scalar first, so that tests can check them against each other
+    std::vector<ScanFunctions> GetAllScanFunctions();
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "Json/Binding.h"
+
+namespace Json
+{
+    // The console colors in the PIPE_PROPERTY_COLORS value of GetState and SetState.
+    // Numbers are sent as strings, older builds only read them that way. Zero means the value was missing.
+    struct ConsoleColors
+    {
+        unsigned long indexes;
+        std::array<COLORREF, 16> table;
+
+        static auto Fields()
+        {
+            return std::make_tuple(
+                Json::MakeField(Json::Key(L"indexes"), &ConsoleColors::indexes, Json::FieldFormat::String),
+                Json::MakeIndexedField(&ConsoleColors::table, Json::FieldFormat::String));
+        }
+
+        bool IsSet() const
+        {
+            for (COLORREF color : this->table)
+            {
+                if (color)
+                {
+                    return true;
+                }
+            }
+
+            return this->indexes != 0;
+        }
+    };
+}
@@ -0,0 +1,188 @@
+﻿#include "stdafx.h"
+#include "Json/Persist.h"
+#include "Json/Stream.h"
+
+// Lines are written to the file in batches of about this size
+static const size_t FLUSH_SIZE = 65536;
+
+static const char UTF8_BOM[] = "\xEF\xBB\xBF";
+
+Json::StreamWriter::StreamWriter()
+    : file(nullptr)
+{
+}
+
+Json::StreamWriter::~StreamWriter()
+{
+    this->Close();
+}
+
+bool Json::StreamWriter::Open(const wchar_t* path)
+{
+    this->Close();
+
+    HANDLE file = ::CreateFile(path, FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    this->file = file;
+    return true;
+}
+
+// Anything that was still buffered gets written first
+bool Json::StreamWriter::Close()
+{
+    bool status = true;
+
+    if (this->file)
+    {
+        status = this->Flush();
+        ::CloseHandle(this->file);
+        this->file = nullptr;
+    }
+
+    return status;
+}
+
+// Writer escapes line breaks in strings, so the only newline is the one at the end
+bool Json::StreamWriter::Append(const Dict& dict)
+{
+    this->writer.Clear();
+    this->writer.Write(dict);
+
+    this->buffer.append(this->writer.GetUtf8());
+    this->buffer.push_back('\n');
+
+    return (this->file && this->buffer.size() >= ::FLUSH_SIZE) ? this->Flush() : true;
+}
+
+// Only what was written gets removed from the buffer, so trying again after a failure doesn't repeat any lines
+bool Json::StreamWriter::Flush()
+{
+    while (this->file && !this->buffer.empty())
+    {
+        DWORD size = static_cast<DWORD>(std::min<size_t>(this->buffer.size(), MAXDWORD));
+        DWORD bytesWritten = 0;
+        BOOL status = ::WriteFile(this->file, this->buffer.data(), size, &bytesWritten, nullptr);
+        this->buffer.erase(0, bytesWritten);
+
+        if (!status || !bytesWritten)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string_view Json::StreamWriter::GetUtf8() const
+{
+    return this->buffer;
+}
+
+void Json::StreamWriter::Clear()
+{
+    this->buffer.clear();
+}
+
+Json::StreamReader::StreamReader(const ParseLimits& limits)
+    : parser(limits)
+    , pos(nullptr)
+    , end(nullptr)
+    , line(0)
+    , errorPos(std::wstring::npos)
+{
+}
+
+void Json::StreamReader::Open(const void* data, size_t size)
+{
+    this->file.reset();
+    this->pos = static_cast<const char*>(data);
+    this->end = this->pos + size;
+    this->line = 0;
+    this->errorPos = std::wstring::npos;
+    this->parser.Reset();
+
+    if (size >= 3 && std::memcmp(this->pos, ::UTF8_BOM, 3) == 0)
+    {
+        this->pos += 3;
+    }
+}
+
+// An empty file can't be mapped, but it's still a valid stream with nothing in it
+bool Json::StreamReader::Open(const wchar_t* path)
+{
+    size_t size;
+    std::shared_ptr<const BYTE> file = Json::MapFile(path, size);
+    this->Open(file.get(), size);
+    this->file = std::move(file);
+
+    if (!this->file)
+    {
+        DWORD attributes = ::GetFileAttributes(path);
+        return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+    }
+
+    return true;
+}
+
+bool Json::StreamReader::Next()
+{
+    while (this->pos && this->pos < this->end)
+    {
+        const char* lineStart = this->pos;
+        const char* lineEnd = static_cast<const char*>(std::memchr(lineStart, '\n', this->end - lineStart));
+        lineEnd = lineEnd ? lineEnd : this->end;
+
+        this->pos = (lineEnd < this->end) ? lineEnd + 1 : this->end;
+        this->line++;
+
+        // Blank lines and lines with only spaces are skipped, CR of a CRLF is a space too
+        if (std::string_view(lineStart, lineEnd - lineStart).find_first_not_of(" \t\r") == std::string_view::npos)
+        {
+            continue;
+        }
+
+        // Lines are always UTF-8, even one that starts like a binary message
+        this->parser.ResetUtf8();
+        this->parser.Feed(lineStart, lineEnd - lineStart);
+
+        if (this->parser.Finish())
+        {
+            this->errorPos = std::wstring::npos;
+        }
+        else
+        {
+            // An object that never ended doesn't have an error position of its own
+            this->errorPos = this->parser.GetErrorPos();
+            this->errorPos = (this->errorPos != std::wstring::npos) ? this->errorPos : 0;
+        }
+
+        return true;
+    }
+
+    this->parser.Reset();
+    return false;
+}
+
+const Json::Document& Json::StreamReader::GetDocument() const
+{
+    return this->parser.GetDocument();
+}
+
+Json::Document Json::StreamReader::TakeDocument()
+{
+    return this->parser.TakeDocument();
+}
+
+size_t Json::StreamReader::GetLine() const
+{
+    return this->line;
+}
+
+size_t Json::StreamReader::GetErrorPos() const
+{
+    return this->errorPos;
+}
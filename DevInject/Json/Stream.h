@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include "Json/ChunkParser.h"
+#include "Json/Writer.h"
+
+namespace Json
+{
+    // Appends objects as newline delimited JSON, one compact UTF-8 object per line.
+    // Without a file the lines collect in the buffer. With a file they're written out
+    // whenever the buffer gets big, so memory stays the same no matter how long the stream is.
+    class StreamWriter
+    {
+    public:
+        DEV_INJECT_API StreamWriter();
+        DEV_INJECT_API ~StreamWriter();
+
+        // New lines go after whatever the file already has
+        DEV_INJECT_API bool Open(const wchar_t* path);
+        DEV_INJECT_API bool Close();
+
+        DEV_INJECT_API bool Append(const Dict& dict);
+        DEV_INJECT_API bool Flush();
+
+        // Lines that weren't written to a file yet
+        DEV_INJECT_API std::string_view GetUtf8() const;
+        DEV_INJECT_API void Clear();
+
+    private:
+        Writer writer;
+        std::string buffer;
+        HANDLE file;
+    };
+
+    // Reads newline delimited JSON one object at a time. Each line is parsed by Next(), into the
+    // same arena as the line before unless a value from it was kept. Blank lines are skipped.
+    class StreamReader
+    {
+    public:
+        DEV_INJECT_API StreamReader(const ParseLimits& limits = ParseLimits());
+
+        // The data must stay alive while it's read
+        DEV_INJECT_API void Open(const void* data, size_t size);
+
+        // The file is mapped, so only the pages that are being read need to be in memory
+        DEV_INJECT_API bool Open(const wchar_t* path);
+
+        // False at the end. A line that isn't one whole object still returns true, with an error.
+        DEV_INJECT_API bool Next();
+
+        DEV_INJECT_API const Document& GetDocument() const;
+        DEV_INJECT_API Document TakeDocument();
+
+        // The current line's number counted from one, and the error's char offset within it
+        DEV_INJECT_API size_t GetLine() const;
+        DEV_INJECT_API size_t GetErrorPos() const;
+
+    private:
+        ChunkParser parser;
+        std::shared_ptr<const BYTE> file;
+        const char* pos;
+        const char* end;
+        size_t line;
+        size_t errorPos;
+    };
+}
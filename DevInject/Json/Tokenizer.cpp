@@ -1,7 +1,12 @@
 ﻿#include "stdafx.h"
+#include "Json/Scan.h"
 #include "Json/Tokenizer.h"
 
-Json::Value Json::Token::GetValue() const
+// 2^63 and 2^64, the first whole doubles past the 64-bit integer ranges
+static const double INT64_END = 9223372036854775808.0;
+static const double UINT64_END = 18446744073709551616.0;
+
+Json::Value Json::Token::GetValue(const std::shared_ptr<Arena>& arena) const
 {
     switch (this->type)
     {
@@ -15,126 +20,240 @@ Json::Value Json::Token::GetValue() const
         return Value(nullptr);
 
     case TokenType::Number:
-    {
-        wchar_t* end = nullptr;
-        double val = wcstod(this->start, &end);
+        return this->GetNumber();
+
+    case TokenType::String:
+        if (!this->escaped)
+        {
+            std::wstring_view chars(this->start + 1, this->length - 2);
 
-        if (end == this->start + this->length)
+            // Strings from a document point right into its copy of the text
+            return (arena && chars.size() > Value::SHORT_STRING_SIZE)
+                ? Value(std::shared_ptr<const wchar_t>(arena, chars.data()), chars.size())
+                : Value(chars);
+        }
+        else if (this->length - 2 <= Value::SHORT_STRING_SIZE)
         {
-            if (std::floor(val) == val && val >= static_cast<double>(INT_MIN) && val <= static_cast<double>(INT_MAX))
+            // Short strings are stored inside of the Value, no need to allocate anything
+            wchar_t chars[Value::SHORT_STRING_SIZE];
+            size_t len = this->Unescape(chars);
+            if (len != std::wstring::npos)
             {
-                return Value(static_cast<int>(val));
+                return Value(std::wstring_view(chars, len));
             }
-            else
+        }
+        else if (arena)
+        {
+            wchar_t* chars = arena->AllocateString(this->length - 2);
+            size_t len = this->Unescape(chars);
+            if (len != std::wstring::npos)
             {
-                return Value(val);
+                return Value(std::shared_ptr<const wchar_t>(arena, chars), len);
             }
         }
+        else
+        {
+            std::wstring val(this->length - 2, L'\0');
+            size_t len = this->Unescape(&val[0]);
+            if (len != std::wstring::npos)
+            {
+                val.resize(len);
+                return Value(std::move(val));
+            }
+        }
+        break;
     }
-    break;
 
+    return Value();
+}
+
+// True when GetValue would read a value, for text that's checked now and parsed later.
+// The tokenizer already checked the escapes in strings.
+bool Json::Token::HasValue() const
+{
+    switch (this->type)
+    {
+    case TokenType::True:
+    case TokenType::False:
+    case TokenType::Null:
     case TokenType::String:
+        return true;
+
+    case TokenType::Number:
+        return !this->GetNumber().IsUnset();
+
+    default:
+        return false;
+    }
+}
+
+// Numbers are ASCII, so they get narrowed for std::from_chars, which is exact and ignores the locale.
+// It also stops at the end of the token, the text after it might not be null terminated.
+Json::Value Json::Token::GetNumber() const
+{
+    char shortChars[64];
+    std::string longChars;
+    char* chars = shortChars;
+
+    if (this->length > _countof(shortChars))
+    {
+        // Huge or very long numbers
+        longChars.resize(this->length);
+        chars = &longChars[0];
+    }
+
+    bool integer = true;
+    for (size_t i = 0; i < this->length; i++)
     {
-        std::wstring val;
-        val.reserve(this->length);
+        chars[i] = static_cast<char>(this->start[i]);
+        integer = integer && chars[i] != '.' && chars[i] != 'e' && chars[i] != 'E';
+    }
+
+    const char* end = chars + this->length;
 
-        const wchar_t* cur = this->start + 1;
-        for (const wchar_t* end = this->start + this->length - 1; cur && cur < end; )
+    if (integer)
+    {
+        long long val;
+        std::from_chars_result result = std::from_chars(chars, end, val);
+        if (result.ec == std::errc() && result.ptr == end)
+        {
+            return Value(val);
+        }
+
+        unsigned long long uval;
+        result = std::from_chars(chars, end, uval);
+        if (result.ec == std::errc() && result.ptr == end)
         {
-            if (*cur == '\\')
+            return Value(uval);
+        }
+    }
+
+    double val;
+    std::from_chars_result result = std::from_chars(chars, end, val);
+    if (result.ec == std::errc() && result.ptr == end)
+    {
+        return Json::Token::GetDoubleValue(val);
+    }
+
+    return Value();
+}
+
+// Whole numbers like 1.0 or 1e10 are still read as integers, so they equal the same number written without a fraction
+Json::Value Json::Token::GetDoubleValue(double val)
+{
+    if (std::floor(val) == val)
+    {
+        if (val >= -::INT64_END && val < ::INT64_END)
+        {
+            return Value(static_cast<long long>(val));
+        }
+
+        if (val >= 0 && val < ::UINT64_END)
+        {
+            return Value(static_cast<unsigned long long>(val));
+        }
+    }
+
+    return Value(val);
+}
+
+// Writes the string contents without quotes or escapes, output must have room for length - 2 chars.
+// Returns the unescaped length, or npos when there is a bad escape.
+size_t Json::Token::Unescape(wchar_t* output) const
+{
+    wchar_t* val = output;
+    const wchar_t* cur = this->start + 1;
+    for (const wchar_t* end = this->start + this->length - 1; cur && cur < end; )
+    {
+        if (*cur == '\\')
+        {
+            switch (cur[1])
             {
-                switch (cur[1])
-                {
-                case '\"':
-                case '\\':
-                case '/':
-                    val.append(1, cur[1]);
-                    cur += 2;
-                    break;
+            case '\"':
+            case '\\':
+            case '/':
+                *val++ = cur[1];
+                cur += 2;
+                break;
 
-                case 'b':
-                    val.append(1, '\b');
-                    cur += 2;
-                    break;
+            case 'b':
+                *val++ = '\b';
+                cur += 2;
+                break;
 
-                case 'f':
-                    val.append(1, '\f');
-                    cur += 2;
-                    break;
+            case 'f':
+                *val++ = '\f';
+                cur += 2;
+                break;
 
-                case 'n':
-                    val.append(1, '\n');
-                    cur += 2;
-                    break;
+            case 'n':
+                *val++ = '\n';
+                cur += 2;
+                break;
 
-                case 'r':
-                    val.append(1, '\r');
-                    cur += 2;
-                    break;
+            case 'r':
+                *val++ = '\r';
+                cur += 2;
+                break;
 
-                case 't':
-                    val.append(1, '\t');
-                    cur += 2;
-                    break;
+            case 't':
+                *val++ = '\t';
+                cur += 2;
+                break;
+
+            case 'u':
+                if (cur + 5 < end)
+                {
+                    wchar_t buffer[5] = { cur[2], cur[3], cur[4], cur[5], '\0' };
+                    wchar_t* stopped = nullptr;
+                    unsigned long decoded = wcstoul(buffer, &stopped, 16);
 
-                case 'u':
-                    if (cur + 5 < end)
+                    if (!*stopped)
                     {
-                        wchar_t buffer[5] = { cur[2], cur[3], cur[4], cur[5], '\0' };
-                        wchar_t* stopped = nullptr;
-                        unsigned long decoded = wcstoul(buffer, &stopped, 16);
-
-                        if (!*stopped)
-                        {
-                            val.append(1, (wchar_t)(decoded & 0xFFFF));
-                            cur += 6;
-                        }
-                        else
-                        {
-                            cur = nullptr;
-                        }
+                        *val++ = (wchar_t)(decoded & 0xFFFF);
+                        cur += 6;
                     }
                     else
                     {
                         cur = nullptr;
                     }
-                    break;
-
-                default:
+                }
+                else
+                {
                     cur = nullptr;
-                    break;
                 }
-            }
-            else
-            {
-                val.append(1, *cur);
-                cur++;
+                break;
+
+            default:
+                cur = nullptr;
+                break;
             }
         }
-
-        if (cur)
+        else
         {
-            return Value(std::move(val));
+            *val++ = *cur;
+            cur++;
         }
     }
-    break;
-    }
 
-    return Value();
+    return cur ? static_cast<size_t>(val - output) : std::wstring::npos;
 }
 
 Json::Tokenizer::Tokenizer(const wchar_t* text, size_t len)
     : text(text)
     , pos(text)
-    , end(text + (len ? len : std::wcslen(text)))
+    , end(text + len)
+    , reachedEnd(false)
 {
 }
 
 Json::Token Json::Tokenizer::NextToken()
 {
+    this->reachedEnd = false;
     wchar_t ch = SkipSpacesAndComments(CurrentChar());
     TokenType type = TokenType::Error;
     const wchar_t* start = this->pos;
+    bool escaped = false;
 
     switch (ch)
     {
@@ -177,7 +296,7 @@ Json::Token Json::Tokenizer::NextToken()
         break;
 
     case '\"':
-        if (SkipString(ch))
+        if (SkipString(ch, escaped))
         {
             type = TokenType::String;
         }
@@ -231,10 +350,17 @@ Json::Token Json::Tokenizer::NextToken()
         break;
     }
 
-    return Token{ type, start, (size_t)(this->pos - start) };
+    return Token{ type, start, (size_t)(this->pos - start), escaped };
 }
 
-bool Json::Tokenizer::SkipString(wchar_t& ch)
+// True when the last token (or the spaces before it) ran into the end of the text,
+// so more text could still change it. Chunked parsing waits for more text in that case.
+bool Json::Tokenizer::ReachedEnd() const
+{
+    return this->reachedEnd;
+}
+
+bool Json::Tokenizer::SkipString(wchar_t& ch, bool& escaped)
 {
     if (ch != '\"')
     {
@@ -252,6 +378,7 @@ bool Json::Tokenizer::SkipString(wchar_t& ch)
         }
         else if (ch == '\\')
         {
+            escaped = true;
             ch = NextChar();
 
             switch (ch)
@@ -270,6 +397,7 @@ bool Json::Tokenizer::SkipString(wchar_t& ch)
             case 'u':
                 if (this->pos > this->end - 5)
                 {
+                    this->reachedEnd = true;
                     return false;
                 }
 
@@ -295,7 +423,9 @@ bool Json::Tokenizer::SkipString(wchar_t& ch)
         }
         else
         {
-            ch = NextChar();
+            // Jump to the next quote, backslash, or control char
+            this->pos = Json::ScanStringChars(this->pos + 1, this->end);
+            ch = CurrentChar();
         }
     }
 
@@ -351,7 +481,8 @@ bool Json::Tokenizer::SkipDigits(wchar_t& ch)
 
     do
     {
-        ch = NextChar();
+        this->pos = Json::ScanDigits(this->pos + 1, this->end);
+        ch = CurrentChar();
     } while (iswdigit(ch));
 
     return true;
@@ -378,7 +509,9 @@ wchar_t Json::Tokenizer::SkipSpacesAndComments(wchar_t ch)
     {
         if (iswspace(ch))
         {
-            ch = NextChar();
+            // Other kinds of spaces are still handled one at a time by iswspace
+            this->pos = Json::ScanSpaces(this->pos + 1, this->end);
+            ch = CurrentChar();
         }
         else if (ch == '/')
         {
@@ -430,17 +563,30 @@ wchar_t Json::Tokenizer::SkipSpacesAndComments(wchar_t ch)
     return ch;
 }
 
-wchar_t Json::Tokenizer::CurrentChar() const
+wchar_t Json::Tokenizer::CurrentChar()
 {
-    return this->pos < this->end ? *this->pos : '\0';
+    if (this->pos < this->end)
+    {
+        return *this->pos;
+    }
+
+    this->reachedEnd = true;
+    return '\0';
 }
 
 wchar_t Json::Tokenizer::NextChar()
 {
-    return ++this->pos < this->end ? *this->pos : '\0';
+    this->pos++;
+    return this->CurrentChar();
 }
 
 wchar_t Json::Tokenizer::PeekNextChar()
 {
-    return this->pos < this->end - 1 ? this->pos[1] : '\0';
+    if (this->pos < this->end - 1)
+    {
+        return this->pos[1];
+    }
+
+    this->reachedEnd = true;
+    return '\0';
 }
@@ -1,5 +1,6 @@
 ﻿#pragma once
 
+#include "Json/Arena.h"
 #include "Json/Value.h"
 
 namespace Json
@@ -23,32 +24,41 @@ namespace Json
 
     struct Token
     {
-        Value GetValue() const;
+        // When an arena is passed in, the token text must also be owned by that arena
+        Value GetValue(const std::shared_ptr<Arena>& arena = nullptr) const;
+        size_t Unescape(wchar_t* output) const;
+        Value GetNumber() const;
+        bool HasValue() const;
+        static Value GetDoubleValue(double val);
 
         TokenType type;
         const wchar_t* start;
         size_t length;
+        bool escaped; // string has at least one backslash
     };
 
     class Tokenizer
     {
     public:
-        Tokenizer(const wchar_t* text, size_t len = 0);
+        // The text doesn't have to be null terminated, so the length is always needed
+        Tokenizer(const wchar_t* text, size_t len);
 
         Token NextToken();
+        bool ReachedEnd() const;
 
     private:
-        bool SkipString(wchar_t& ch);
+        bool SkipString(wchar_t& ch, bool& escaped);
         bool SkipNumber(wchar_t& ch);
         bool SkipDigits(wchar_t& ch);
         bool SkipIdentifier(wchar_t& ch);
         wchar_t SkipSpacesAndComments(wchar_t ch);
-        wchar_t CurrentChar() const;
+        wchar_t CurrentChar();
         wchar_t NextChar();
         wchar_t PeekNextChar();
 
         const wchar_t* text;
         const wchar_t* pos;
         const wchar_t* end;
+        bool reachedEnd;
     };
 }
@@ -0,0 +1,213 @@
+﻿#include "stdafx.h"
+#include "Json/Utf8.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#define JSON_UTF8_SSE2
+static_assert(sizeof(wchar_t) == 2, "SSE2 transcoding expects UTF-16 wchar_t");
+#endif
+
+static const wchar_t REPLACEMENT_CHAR = 0xFFFD;
+
+size_t Json::Utf16ToUtf8(const wchar_t* text, size_t len, char* output)
+{
+    char* out = output;
+
+    for (const wchar_t* end = text + len; text != end; )
+    {
+#ifdef JSON_UTF8_SSE2
+        // ASCII runs get narrowed 16 chars at a time
+        const __m128i nonAsciiMask = _mm_set1_epi16(static_cast<short>(0xFF80));
+        while (end - text >= 16)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + 8));
+            __m128i nonAscii = _mm_and_si128(_mm_or_si128(a, b), nonAsciiMask);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, _mm_setzero_si128())) != 0xFFFF)
+            {
+                break;
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+            text += 16;
+            out += 16;
+        }
+
+        if (text == end)
+        {
+            break;
+        }
+#endif
+        unsigned int ch = static_cast<unsigned int>(*text++);
+
+        if (ch >= 0xD800 && ch <= 0xDBFF && text != end && *text >= 0xDC00 && *text <= 0xDFFF)
+        {
+            ch = 0x10000 + ((ch - 0xD800) << 10) + (static_cast<unsigned int>(*text++) - 0xDC00);
+        }
+
+        if (ch < 0x80)
+        {
+            *out++ = static_cast<char>(ch);
+        }
+        else if (ch < 0x800)
+        {
+            *out++ = static_cast<char>(0xC0 | (ch >> 6));
+            *out++ = static_cast<char>(0x80 | (ch & 0x3F));
+        }
+        else if (ch < 0x10000)
+        {
+            // Unpaired surrogates are kept as three bytes so that any Windows string round trips
+            *out++ = static_cast<char>(0xE0 | (ch >> 12));
+            *out++ = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (ch & 0x3F));
+        }
+        else
+        {
+            *out++ = static_cast<char>(0xF0 | (ch >> 18));
+            *out++ = static_cast<char>(0x80 | ((ch >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (ch & 0x3F));
+        }
+    }
+
+    return out - output;
+}
+
+size_t Json::Utf8ToUtf16(const char* text, size_t len, wchar_t* output)
+{
+    const unsigned char* pos = reinterpret_cast<const unsigned char*>(text);
+    const unsigned char* end = pos + len;
+    wchar_t* out = output;
+
+    while (pos != end)
+    {
+#ifdef JSON_UTF8_SSE2
+        // ASCII runs get widened 16 bytes at a time
+        while (end - pos >= 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            if (_mm_movemask_epi8(bytes))
+            {
+                break;
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(bytes, _mm_setzero_si128()));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(bytes, _mm_setzero_si128()));
+            pos += 16;
+            out += 16;
+        }
+
+        if (pos == end)
+        {
+            break;
+        }
+#endif
+        unsigned int ch = *pos++;
+        if (ch < 0x80)
+        {
+            *out++ = static_cast<wchar_t>(ch);
+            continue;
+        }
+
+        // Figure out the sequence length and the valid range of the second byte (rejects overlong forms)
+        size_t extra = 0;
+        unsigned int low = 0x80;
+        unsigned int high = 0xBF;
+
+        if (ch >= 0xC2 && ch <= 0xDF)
+        {
+            extra = 1;
+            ch &= 0x1F;
+        }
+        else if (ch >= 0xE0 && ch <= 0xEF)
+        {
+            extra = 2;
+            low = (ch == 0xE0) ? 0xA0 : 0x80;
+            ch &= 0x0F;
+        }
+        else if (ch >= 0xF0 && ch <= 0xF4)
+        {
+            extra = 3;
+            low = (ch == 0xF0) ? 0x90 : 0x80;
+            high = (ch == 0xF4) ? 0x8F : 0xBF;
+            ch &= 0x07;
+        }
+
+        bool valid = extra && static_cast<size_t>(end - pos) >= extra && *pos >= low && *pos <= high;
+        for (size_t i = 1; valid && i < extra; i++)
+        {
+            valid = (pos[i] & 0xC0) == 0x80;
+        }
+
+        if (!valid)
+        {
+            // Only the lead byte is dropped, the next byte might start a valid sequence
+            *out++ = ::REPLACEMENT_CHAR;
+            continue;
+        }
+
+        for (size_t i = 0; i < extra; i++)
+        {
+            ch = (ch << 6) | (*pos++ & 0x3F);
+        }
+
+        if (ch >= 0x10000 && sizeof(wchar_t) == 2)
+        {
+            ch -= 0x10000;
+            *out++ = static_cast<wchar_t>(0xD800 + (ch >> 10));
+            *out++ = static_cast<wchar_t>(0xDC00 + (ch & 0x3FF));
+        }
+        else
+        {
+            *out++ = static_cast<wchar_t>(ch);
+        }
+    }
+
+    return out - output;
+}
+
+size_t Json::GetUtf8Length(const wchar_t* text, size_t len)
+{
+    size_t size = 0;
+
+    for (const wchar_t* end = text + len; text != end; text++)
+    {
+        unsigned int ch = static_cast<unsigned int>(*text);
+
+        if (ch < 0x80)
+        {
+            size += 1;
+        }
+        else if (ch < 0x800)
+        {
+            size += 2;
+        }
+        else if (ch >= 0xD800 && ch <= 0xDBFF && text + 1 != end && text[1] >= 0xDC00 && text[1] <= 0xDFFF)
+        {
+            size += 4;
+            text++;
+        }
+        else
+        {
+            size += (ch < 0x10000) ? 3 : 4;
+        }
+    }
+
+    return size;
+}
+
+std::string Json::ToUtf8(std::wstring_view text)
+{
+    std::string output;
+    output.resize(text.size() * 3);
+    output.resize(Json::Utf16ToUtf8(text.data(), text.size(), &output[0]));
+    return output;
+}
+
+std::wstring Json::ToUtf16(std::string_view text)
+{
+    std::wstring output;
+    output.resize(text.size());
+    output.resize(Json::Utf8ToUtf16(text.data(), text.size(), &output[0]));
+    return output;
+}
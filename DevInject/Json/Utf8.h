@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include "Api.h"
+
+namespace Json
+{
+    // UTF-16 to UTF-8, output needs room for len * 3 bytes. Returns the number of bytes written.
+    DEV_INJECT_API size_t Utf16ToUtf8(const wchar_t* text, size_t len, char* output);
+
+    // UTF-8 to UTF-16, output needs room for len chars. Returns the number of chars written.
+    DEV_INJECT_API size_t Utf8ToUtf16(const char* text, size_t len, wchar_t* output);
+
+    // Number of UTF-8 bytes needed for UTF-16 text
+    DEV_INJECT_API size_t GetUtf8Length(const wchar_t* text, size_t len);
+
+    DEV_INJECT_API std::string ToUtf8(std::wstring_view text);
+    DEV_INJECT_API std::wstring ToUtf16(std::string_view text);
+}
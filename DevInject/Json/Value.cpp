@@ -1,5 +1,7 @@
 ﻿#include "stdafx.h"
 #include "Json/Dict.h"
+#include "Json/Lazy.h"
+#include "Json/Tokenizer.h"
 
 Json::Value::Value()
     : type(Type::Unset)
@@ -23,6 +25,28 @@ Json::Value::Value(int value)
 {
 }
 
+// Integers always use the smallest type that holds them, so equal numbers have equal types
+Json::Value::Value(long long value)
+    : type(Type::Int64)
+    , int64Data(value)
+{
+    if (value >= INT_MIN && value <= INT_MAX)
+    {
+        this->type = Type::Int;
+        this->intData = static_cast<int>(value);
+    }
+}
+
+Json::Value::Value(unsigned long long value)
+    : type(Type::UInt64)
+    , uint64Data(value)
+{
+    if (value <= static_cast<unsigned long long>(LLONG_MAX))
+    {
+        this->Move(Value(static_cast<long long>(value)));
+    }
+}
+
 Json::Value::Value(double value)
     : type(Type::Double)
     , doubleData(value)
@@ -30,20 +54,46 @@ Json::Value::Value(double value)
 }
 
 Json::Value::Value(const wchar_t* value)
-    : type(Type::String)
-    , stringData(std::make_shared<std::wstring>(value))
+    : Value(std::wstring_view(value))
 {
 }
 
+Json::Value::Value(std::wstring_view value)
+    : type(Type::Unset)
+{
+    if (value.size() <= Value::SHORT_STRING_SIZE)
+    {
+        this->InitShortString(value.data(), value.size());
+    }
+    else
+    {
+        this->Move(Value(std::wstring(value)));
+    }
+}
+
 Json::Value::Value(std::wstring&& value)
     : type(Type::String)
-    , stringData(std::make_shared<std::wstring>(std::move(value)))
+{
+    if (value.size() <= Value::SHORT_STRING_SIZE)
+    {
+        this->InitShortString(value.data(), value.size());
+    }
+    else
+    {
+        std::shared_ptr<std::wstring> owner = std::make_shared<std::wstring>(std::move(value));
+        ::new(&this->stringData) StringData{ std::shared_ptr<const wchar_t>(owner, owner->c_str()), owner->size() };
+    }
+}
+
+// Handles are sent as numbers
+Json::Value::Value(HWND value)
+    : Value(static_cast<unsigned long long>(reinterpret_cast<size_t>(value)))
 {
 }
 
-Json::Value::Value(std::vector<Value>&& value)
+Json::Value::Value(std::pmr::vector<Value>&& value)
     : type(Type::Vector)
-    , vectorData(std::make_shared<std::vector<Value>>(std::move(value)))
+    , vectorData(std::make_shared<std::pmr::vector<Value>>(std::move(value)))
 {
 }
 
@@ -53,7 +103,40 @@ Json::Value::Value(Dict&& value)
 {
 }
 
-Json::Value::Value(Value&& rhs)
+// The chars must stay valid and unchanged for as long as they are shared
+Json::Value::Value(std::shared_ptr<const wchar_t>&& chars, size_t length)
+    : type(Type::String)
+{
+    if (length <= Value::SHORT_STRING_SIZE)
+    {
+        this->InitShortString(chars.get(), length);
+    }
+    else
+    {
+        ::new(&this->stringData) StringData{ std::move(chars), length };
+    }
+}
+
+Json::Value::Value(std::shared_ptr<std::pmr::vector<Value>>&& value)
+    : type(Type::Vector)
+    , vectorData(std::move(value))
+{
+}
+
+Json::Value::Value(std::shared_ptr<Dict>&& value)
+    : type(Type::Dict)
+    , dictData(std::move(value))
+{
+}
+
+Json::Value::Value(std::shared_ptr<LazyValue>&& value)
+    : type(Type::Lazy)
+    , lazyData(std::move(value))
+{
+}
+
+// Vectors only move their values when they grow if this can't throw, otherwise every value and key gets copied
+Json::Value::Value(Value&& rhs) noexcept
     : type(Type::Unset)
 {
     this->Move(std::move(rhs));
@@ -70,7 +153,7 @@ Json::Value::~Value()
     this->Clear();
 }
 
-const Json::Value& Json::Value::operator=(Value&& rhs)
+const Json::Value& Json::Value::operator=(Value&& rhs) noexcept
 {
     this->Move(std::move(rhs));
     return *this;
@@ -84,6 +167,32 @@ const Json::Value& Json::Value::operator=(const Value& rhs)
 
 bool Json::Value::operator==(const Value& rhs) const
 {
+    if (this->type == Type::Lazy || rhs.type == Type::Lazy)
+    {
+        return this->GetParsed() == rhs.GetParsed();
+    }
+
+    if (this->IsString() && rhs.IsString())
+    {
+        return this->GetString() == rhs.GetString();
+    }
+
+    // A whole double equals the integer it holds, however it was made
+    if (this->type != rhs.type && this->IsNumber() && rhs.IsNumber())
+    {
+        if (this->type == Type::Double)
+        {
+            Value whole = Json::Token::GetDoubleValue(this->doubleData);
+            return whole.type != Type::Double && whole == rhs;
+        }
+
+        if (rhs.type == Type::Double)
+        {
+            Value whole = Json::Token::GetDoubleValue(rhs.doubleData);
+            return whole.type != Type::Double && whole == *this;
+        }
+    }
+
     if (this->type == rhs.type)
     {
         switch (this->type)
@@ -94,12 +203,15 @@ bool Json::Value::operator==(const Value& rhs) const
         case Type::Int:
             return this->intData == rhs.intData;
 
+        case Type::Int64:
+            return this->int64Data == rhs.int64Data;
+
+        case Type::UInt64:
+            return this->uint64Data == rhs.uint64Data;
+
         case Type::Double:
             return this->doubleData == rhs.doubleData;
 
-        case Type::String:
-            return *this->stringData == *rhs.stringData;
-
         case Type::Vector:
             return *this->vectorData == *rhs.vectorData;
 
@@ -114,6 +226,53 @@ bool Json::Value::operator==(const Value& rhs) const
     return false;
 }
 
+// Must agree with operator==, so both kinds of strings hash the same and whole doubles hash like integers
+size_t Json::Value::GetHash() const
+{
+    size_t hash = static_cast<size_t>(this->type);
+
+    switch (this->type)
+    {
+    case Type::Bool:
+        return Json::CombineHash(hash, this->boolData);
+
+    case Type::Int:
+        return Json::CombineHash(hash, std::hash<int>()(this->intData));
+
+    case Type::Int64:
+        return Json::CombineHash(hash, std::hash<long long>()(this->int64Data));
+
+    case Type::UInt64:
+        return Json::CombineHash(hash, std::hash<unsigned long long>()(this->uint64Data));
+
+    case Type::Double:
+        {
+            Value whole = Json::Token::GetDoubleValue(this->doubleData);
+            return (whole.type != Type::Double) ? whole.GetHash() : Json::CombineHash(hash, std::hash<double>()(this->doubleData));
+        }
+
+    case Type::String:
+    case Type::ShortString:
+        return Json::HashKey(this->GetString());
+
+    case Type::Vector:
+        for (const Value& value : *this->vectorData)
+        {
+            hash = Json::CombineHash(hash, value.GetHash());
+        }
+        return hash;
+
+    case Type::Dict:
+        return this->dictData->GetHash();
+
+    case Type::Lazy:
+        return this->lazyData->Get().GetHash();
+
+    default:
+        return hash;
+    }
+}
+
 bool Json::Value::IsUnset() const
 {
     return this->type == Type::Unset;
@@ -134,24 +293,34 @@ bool Json::Value::IsInt() const
     return this->type == Type::Int;
 }
 
+bool Json::Value::IsInt64() const
+{
+    return this->type == Type::Int || this->type == Type::Int64;
+}
+
+bool Json::Value::IsUInt64() const
+{
+    return (this->type == Type::Int && this->intData >= 0) || (this->type == Type::Int64 && this->int64Data >= 0) || this->type == Type::UInt64;
+}
+
 bool Json::Value::IsNumber() const
 {
-    return this->type == Type::Int || this->type == Type::Double;
+    return this->type == Type::Int || this->type == Type::Int64 || this->type == Type::UInt64 || this->type == Type::Double;
 }
 
 bool Json::Value::IsString() const
 {
-    return this->type == Type::String;
+    return this->type == Type::String || this->type == Type::ShortString;
 }
 
 bool Json::Value::IsVector() const
 {
-    return this->type == Type::Null;
+    return this->type == Type::Vector || (this->type == Type::Lazy && !this->lazyData->IsDict());
 }
 
 bool Json::Value::IsDict() const
 {
-    return this->type == Type::Dict;
+    return this->type == Type::Dict || (this->type == Type::Lazy && this->lazyData->IsDict());
 }
 
 bool Json::Value::GetBool() const
@@ -166,21 +335,69 @@ int Json::Value::GetInt() const
     return this->intData;
 }
 
+long long Json::Value::GetInt64() const
+{
+    assert(this->IsInt64());
+    return (this->type == Type::Int) ? this->intData : this->int64Data;
+}
+
+unsigned long long Json::Value::GetUInt64() const
+{
+    assert(this->IsUInt64());
+    switch (this->type)
+    {
+    case Type::Int:
+        return static_cast<unsigned long long>(this->intData);
+
+    case Type::Int64:
+        return static_cast<unsigned long long>(this->int64Data);
+
+    default:
+        return this->uint64Data;
+    }
+}
+
 double Json::Value::GetDouble() const
 {
     assert(this->IsNumber());
-    return (this->type == Type::Int) ? static_cast<double>(this->intData) : this->doubleData;
+    switch (this->type)
+    {
+    case Type::Int:
+        return static_cast<double>(this->intData);
+
+    case Type::Int64:
+        return static_cast<double>(this->int64Data);
+
+    case Type::UInt64:
+        return static_cast<double>(this->uint64Data);
+
+    default:
+        return this->doubleData;
+    }
 }
 
-const std::wstring& Json::Value::GetString() const
+std::wstring_view Json::Value::GetString() const
 {
     assert(this->IsString());
-    return *this->stringData;
+    return (this->type == Type::ShortString)
+        ? std::wstring_view(this->shortData, this->shortLength)
+        : std::wstring_view(this->stringData.chars.get(), this->stringData.length);
 }
 
 std::wstring Json::Value::TryGetString() const
 {
-    return this->IsString() ? this->GetString() : std::wstring();
+    return this->IsString() ? std::wstring(this->GetString()) : std::wstring();
+}
+
+// Accepts numbers and the older decimal strings
+HWND Json::Value::TryGetHwnd() const
+{
+    if (this->IsUInt64())
+    {
+        return reinterpret_cast<HWND>(static_cast<size_t>(this->GetUInt64()));
+    }
+
+    return this->TryGetHwndFromString();
 }
 
 HWND Json::Value::TryGetHwndFromString() const
@@ -199,18 +416,68 @@ HWND Json::Value::TryGetHwndFromString() const
     return hwnd;
 }
 
-const std::vector<Json::Value> &Json::Value::GetVector() const
+const std::pmr::vector<Json::Value>& Json::Value::GetVector() const
 {
     assert(this->IsVector());
-    return *this->vectorData;
+    return *this->GetParsed().vectorData;
 }
 
 const Json::Dict& Json::Value::GetDict() const
 {
     assert(this->IsDict());
+    return *this->GetParsed().dictData;
+}
+
+Json::Dict& Json::Value::MutableDict()
+{
+    assert(this->IsDict());
+    this->MakeUnique();
     return *this->dictData;
 }
 
+std::pmr::vector<Json::Value>& Json::Value::MutableVector()
+{
+    assert(this->IsVector());
+    this->MakeUnique();
+    return *this->vectorData;
+}
+
+// Copying a Dict only shares its entries, they get copied by the first change.
+// A copied vector goes on the heap even when the original is in a document's arena.
+void Json::Value::MakeUnique()
+{
+    if (this->type == Type::Lazy)
+    {
+        Value parsed = this->lazyData->Get();
+        *this = std::move(parsed);
+    }
+
+    if (this->type == Type::Dict && this->dictData.use_count() > 1)
+    {
+        this->dictData = std::make_shared<Dict>(*this->dictData);
+    }
+    else if (this->type == Type::Vector && this->vectorData.use_count() > 1)
+    {
+        this->vectorData = std::make_shared<std::pmr::vector<Value>>(*this->vectorData);
+    }
+}
+
+// A lazy object or array gets parsed the first time anything inside it is needed
+const Json::Value& Json::Value::GetParsed() const
+{
+    return (this->type == Type::Lazy) ? this->lazyData->Get() : *this;
+}
+
+void Json::Value::InitShortString(const wchar_t* chars, size_t length)
+{
+    assert(this->type == Type::Unset || this->type == Type::String);
+    assert(length <= Value::SHORT_STRING_SIZE);
+
+    this->type = Type::ShortString;
+    this->shortLength = static_cast<unsigned char>(length);
+    std::copy(chars, chars + length, this->shortData);
+}
+
 void Json::Value::Clear()
 {
     switch (this->type)
@@ -220,11 +487,15 @@ void Json::Value::Clear()
         break;
 
     case Type::String:
-        this->stringData.~shared_ptr<std::wstring>();
+        this->stringData.~StringData();
         break;
 
     case Type::Vector:
-        this->vectorData.~shared_ptr<std::vector<Value>>();
+        this->vectorData.~shared_ptr<std::pmr::vector<Value>>();
+        break;
+
+    case Type::Lazy:
+        this->lazyData.~shared_ptr<LazyValue>();
         break;
     }
 
@@ -249,21 +520,38 @@ void Json::Value::Move(Value&& rhs)
             this->intData = rhs.intData;
             break;
 
+        case Type::Int64:
+            this->int64Data = rhs.int64Data;
+            break;
+
+        case Type::UInt64:
+            this->uint64Data = rhs.uint64Data;
+            break;
+
         case Type::Double:
             this->doubleData = rhs.doubleData;
             break;
 
+        case Type::ShortString:
+            this->shortLength = rhs.shortLength;
+            std::copy(rhs.shortData, rhs.shortData + rhs.shortLength, this->shortData);
+            break;
+
         case Type::String:
-            ::new(&this->stringData) std::shared_ptr<std::wstring>(std::move(rhs.stringData));
+            ::new(&this->stringData) StringData{ std::move(rhs.stringData.chars), rhs.stringData.length };
             break;
 
         case Type::Vector:
-            ::new(&this->vectorData) std::shared_ptr<std::vector<Value>>(std::move(rhs.vectorData));
+            ::new(&this->vectorData) std::shared_ptr<std::pmr::vector<Value>>(std::move(rhs.vectorData));
             break;
 
         case Type::Dict:
             ::new(&this->dictData) std::shared_ptr<Dict>(std::move(rhs.dictData));
             break;
+
+        case Type::Lazy:
+            ::new(&this->lazyData) std::shared_ptr<LazyValue>(std::move(rhs.lazyData));
+            break;
         }
     }
 }
@@ -285,21 +573,38 @@ void Json::Value::Copy(const Value& rhs)
             this->intData = rhs.intData;
             break;
 
+        case Type::Int64:
+            this->int64Data = rhs.int64Data;
+            break;
+
+        case Type::UInt64:
+            this->uint64Data = rhs.uint64Data;
+            break;
+
         case Type::Double:
             this->doubleData = rhs.doubleData;
             break;
 
+        case Type::ShortString:
+            this->shortLength = rhs.shortLength;
+            std::copy(rhs.shortData, rhs.shortData + rhs.shortLength, this->shortData);
+            break;
+
         case Type::String:
-            ::new(&this->stringData) std::shared_ptr<std::wstring>(rhs.stringData);
+            ::new(&this->stringData) StringData(rhs.stringData);
             break;
 
         case Type::Vector:
-            ::new(&this->vectorData) std::shared_ptr<std::vector<Value>>(rhs.vectorData);
+            ::new(&this->vectorData) std::shared_ptr<std::pmr::vector<Value>>(rhs.vectorData);
             break;
 
         case Type::Dict:
             ::new(&this->dictData) std::shared_ptr<Dict>(rhs.dictData);
             break;
+
+        case Type::Lazy:
+            ::new(&this->lazyData) std::shared_ptr<LazyValue>(rhs.lazyData);
+            break;
         }
     }
 }
@@ -5,6 +5,7 @@
 namespace Json
 {
     class Dict;
+    class LazyValue;
 
     // One value from a JSON string
     class Value
@@ -14,23 +15,36 @@ namespace Json
         DEV_INJECT_API explicit Value(nullptr_t);
         DEV_INJECT_API explicit Value(bool value);
         DEV_INJECT_API explicit Value(int value);
+        DEV_INJECT_API explicit Value(long long value);
+        DEV_INJECT_API explicit Value(unsigned long long value);
         DEV_INJECT_API explicit Value(double value);
         DEV_INJECT_API explicit Value(const wchar_t* value);
+        DEV_INJECT_API explicit Value(std::wstring_view value);
         DEV_INJECT_API explicit Value(std::wstring&& value);
-        DEV_INJECT_API explicit Value(std::vector<Value>&& value);
+        DEV_INJECT_API explicit Value(HWND value);
+        DEV_INJECT_API explicit Value(std::pmr::vector<Value>&& value);
         DEV_INJECT_API explicit Value(Dict&& value);
-        DEV_INJECT_API Value(Value&& rhs);
+        DEV_INJECT_API Value(std::shared_ptr<const wchar_t>&& chars, size_t length);
+        DEV_INJECT_API explicit Value(std::shared_ptr<std::pmr::vector<Value>>&& value);
+        DEV_INJECT_API explicit Value(std::shared_ptr<Dict>&& value);
+        DEV_INJECT_API explicit Value(std::shared_ptr<LazyValue>&& value);
+        DEV_INJECT_API Value(Value&& rhs) noexcept;
         DEV_INJECT_API Value(const Value& rhs);
         DEV_INJECT_API ~Value();
 
-        DEV_INJECT_API const Value& operator=(Value&& rhs);
+        DEV_INJECT_API const Value& operator=(Value&& rhs) noexcept;
         DEV_INJECT_API const Value& operator=(const Value& rhs);
         DEV_INJECT_API bool operator==(const Value& rhs) const;
 
+        // Equal values have equal hashes, dicts remember theirs until they change
+        DEV_INJECT_API size_t GetHash() const;
+
         DEV_INJECT_API bool IsUnset() const;
         DEV_INJECT_API bool IsNull() const;
         DEV_INJECT_API bool IsBool() const;
         DEV_INJECT_API bool IsInt() const;
+        DEV_INJECT_API bool IsInt64() const;
+        DEV_INJECT_API bool IsUInt64() const;
         DEV_INJECT_API bool IsNumber() const;
         DEV_INJECT_API bool IsString() const;
         DEV_INJECT_API bool IsVector() const;
@@ -38,14 +52,24 @@ namespace Json
 
         DEV_INJECT_API bool GetBool() const;
         DEV_INJECT_API int GetInt() const;
+        DEV_INJECT_API long long GetInt64() const;
+        DEV_INJECT_API unsigned long long GetUInt64() const;
         DEV_INJECT_API double GetDouble() const;
-        DEV_INJECT_API const std::wstring& GetString() const;
+        DEV_INJECT_API std::wstring_view GetString() const;
         DEV_INJECT_API std::wstring TryGetString() const;
+        DEV_INJECT_API HWND TryGetHwnd() const;
         DEV_INJECT_API HWND TryGetHwndFromString() const;
-        DEV_INJECT_API const std::vector<Json::Value> &GetVector() const;
+        DEV_INJECT_API const std::pmr::vector<Json::Value>& GetVector() const;
         DEV_INJECT_API const Dict& GetDict() const;
 
+        // Only this value changes, copies that shared the same dict or vector keep the old one
+        DEV_INJECT_API Dict& MutableDict();
+        DEV_INJECT_API std::pmr::vector<Json::Value>& MutableVector();
+
     private:
+        const Value& GetParsed() const;
+        void MakeUnique();
+        void InitShortString(const wchar_t* chars, size_t length);
         void Clear();
         void Move(Value&& rhs);
         void Copy(const Value& rhs);
@@ -56,20 +80,43 @@ namespace Json
             Null,
             Bool,
             Int,
+            Int64,
+            UInt64,
             Double,
             String,
+            ShortString,
             Vector,
             Dict,
+            Lazy,
         } type;
 
+        // The chars are owned by a std::wstring on the heap or by a Document's arena
+        struct StringData
+        {
+            std::shared_ptr<const wchar_t> chars;
+            size_t length;
+        };
+
+    public:
+        // Strings up to this length are stored inline, like command names and numbers as strings.
+        // It's the same on every platform, on x64 it takes no more room than StringData.
+        static const size_t SHORT_STRING_SIZE = 12;
+
+    private:
+        unsigned char shortLength;
+
         union
         {
             bool boolData;
             int intData;
+            long long int64Data;
+            unsigned long long uint64Data;
             double doubleData;
-            std::shared_ptr<std::wstring> stringData;
-            std::shared_ptr<std::vector<Value>> vectorData;
+            StringData stringData;
+            wchar_t shortData[SHORT_STRING_SIZE];
+            std::shared_ptr<std::pmr::vector<Value>> vectorData;
             std::shared_ptr<Dict> dictData;
+            std::shared_ptr<LazyValue> lazyData;
         };
     };
 }
@@ -0,0 +1,331 @@
+﻿#include "stdafx.h"
+#include "Json/Scan.h"
+#include "Json/Utf8.h"
+#include "Json/Writer.h"
+
+static const wchar_t HEX_CHARS[] = L"0123456789abcdef";
+
+// Chars transcoded at a time by GetUtf8, each one is at most three bytes
+static const size_t UTF8_CHUNK_SIZE = 512;
+
+namespace Json
+{
+    // The same code writes to a buffer or just counts chars for the size pre-pass
+
+    class BufferOutput
+    {
+    public:
+        BufferOutput(std::wstring& text)
+            : text(text)
+        {
+        }
+
+        void Append(wchar_t ch)
+        {
+            this->text.push_back(ch);
+        }
+
+        void Append(const wchar_t* chars, size_t len)
+        {
+            this->text.append(chars, len);
+        }
+
+    private:
+        std::wstring& text;
+    };
+
+    class CountOutput
+    {
+    public:
+        CountOutput()
+            : size(0)
+        {
+        }
+
+        void Append(wchar_t ch)
+        {
+            this->size++;
+        }
+
+        void Append(const wchar_t* chars, size_t len)
+        {
+            this->size += len;
+        }
+
+        size_t GetSize() const
+        {
+            return this->size;
+        }
+
+    private:
+        size_t size;
+    };
+
+    template<class Output> static void WriteValue(const Value& value, Output& output);
+    template<class Output> static void WriteObject(const Dict& dict, Output& output);
+    template<class Output> static void WriteArray(const std::pmr::vector<Value>& values, Output& output);
+    template<class Output> static void WriteNumber(const char* chars, const char* end, Output& output);
+    template<class Output> static void Encode(std::wstring_view value, Output& output);
+}
+
+template<class Output>
+void Json::WriteValue(const Value& value, Output& output)
+{
+    if (value.IsBool())
+    {
+        if (value.GetBool())
+        {
+            output.Append(L"true", 4);
+        }
+        else
+        {
+            output.Append(L"false", 5);
+        }
+    }
+    else if (value.IsInt64())
+    {
+        char chars[24];
+        std::to_chars_result result = std::to_chars(chars, chars + _countof(chars), value.GetInt64());
+        Json::WriteNumber(chars, result.ptr, output);
+    }
+    else if (value.IsUInt64())
+    {
+        char chars[24];
+        std::to_chars_result result = std::to_chars(chars, chars + _countof(chars), value.GetUInt64());
+        Json::WriteNumber(chars, result.ptr, output);
+    }
+    else if (value.IsNumber() && std::isfinite(value.GetDouble()))
+    {
+        // Shortest text that round trips
+        char chars[32];
+        std::to_chars_result result = std::to_chars(chars, chars + _countof(chars), value.GetDouble());
+        Json::WriteNumber(chars, result.ptr, output);
+    }
+    else if (value.IsString())
+    {
+        Json::Encode(value.GetString(), output);
+    }
+    else if (value.IsVector())
+    {
+        Json::WriteArray(value.GetVector(), output);
+    }
+    else if (value.IsDict())
+    {
+        Json::WriteObject(value.GetDict(), output);
+    }
+    else
+    {
+        // JSON has no infinity or NaN either
+        output.Append(L"null", 4);
+    }
+}
+
+template<class Output>
+void Json::WriteObject(const Dict& dict, Output& output)
+{
+    output.Append(L'{');
+
+    bool first = true;
+    for (const auto& i : dict)
+    {
+        if (first)
+        {
+            first = false;
+        }
+        else
+        {
+            output.Append(L',');
+        }
+
+        Json::Encode(i.first, output);
+        output.Append(L':');
+        Json::WriteValue(i.second, output);
+    }
+
+    output.Append(L'}');
+}
+
+template<class Output>
+void Json::WriteArray(const std::pmr::vector<Value>& values, Output& output)
+{
+    output.Append(L'[');
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (i)
+        {
+            output.Append(L',');
+        }
+
+        Json::WriteValue(values[i], output);
+    }
+
+    output.Append(L']');
+}
+
+// Numbers are always ASCII
+template<class Output>
+void Json::WriteNumber(const char* chars, const char* end, Output& output)
+{
+    wchar_t wideChars[32];
+    wchar_t* wideEnd = std::copy(chars, end, wideChars);
+    output.Append(wideChars, wideEnd - wideChars);
+}
+
+template<class Output>
+void Json::Encode(std::wstring_view value, Output& output)
+{
+    output.Append(L'\"');
+
+    for (const wchar_t* ch = value.data(), *end = ch + value.size(); ch != end; ch++)
+    {
+        // Copy everything up to the next char that needs escaping in one shot
+        const wchar_t* special = Json::ScanStringChars(ch, end);
+        output.Append(ch, special - ch);
+
+        if (special == end)
+        {
+            break;
+        }
+
+        ch = special;
+
+        switch (*ch)
+        {
+        case '\"':
+            output.Append(L"\\\"", 2);
+            break;
+
+        case '\\':
+            output.Append(L"\\\\", 2);
+            break;
+
+        case '\b':
+            output.Append(L"\\b", 2);
+            break;
+
+        case '\f':
+            output.Append(L"\\f", 2);
+            break;
+
+        case '\n':
+            output.Append(L"\\n", 2);
+            break;
+
+        case '\r':
+            output.Append(L"\\r", 2);
+            break;
+
+        case '\t':
+            output.Append(L"\\t", 2);
+            break;
+
+        default:
+            {
+                wchar_t escape[6] = { '\\', 'u', '0', '0', ::HEX_CHARS[(*ch >> 4) & 0xF], ::HEX_CHARS[*ch & 0xF] };
+                output.Append(escape, _countof(escape));
+            }
+            break;
+        }
+    }
+
+    output.Append(L'\"');
+}
+
+Json::Writer::Writer()
+{
+}
+
+// Keeps the buffers allocated
+void Json::Writer::Clear()
+{
+    this->text.clear();
+    this->utf8.clear();
+}
+
+void Json::Writer::Write(const Dict& dict, bool exactSize)
+{
+    if (exactSize)
+    {
+        this->text.reserve(this->text.size() + Json::Writer::GetSize(dict));
+    }
+
+    BufferOutput output(this->text);
+    Json::WriteObject(dict, output);
+}
+
+void Json::Writer::Write(const Value& value)
+{
+    BufferOutput output(this->text);
+    Json::WriteValue(value, output);
+}
+
+void Json::Writer::WriteString(std::wstring_view value)
+{
+    BufferOutput output(this->text);
+    Json::Encode(value, output);
+}
+
+void Json::Writer::BeginObject()
+{
+    this->text.push_back(L'{');
+}
+
+// Any value that was written before ends with something other than a brace
+void Json::Writer::WriteKey(std::wstring_view key)
+{
+    if (!this->text.empty() && this->text.back() != L'{')
+    {
+        this->text.push_back(L',');
+    }
+
+    this->WriteString(key);
+    this->text.push_back(L':');
+}
+
+void Json::Writer::EndObject()
+{
+    this->text.push_back(L'}');
+}
+
+std::wstring_view Json::Writer::GetText() const
+{
+    return this->text;
+}
+
+// Transcoded into a buffer that is also reused. It goes through a small chunk on the stack,
+// so the buffer never has to be zero filled to three times the text size first.
+std::string_view Json::Writer::GetUtf8()
+{
+    char chunk[::UTF8_CHUNK_SIZE * 3];
+    this->utf8.clear();
+    this->utf8.reserve(this->text.size());
+
+    for (size_t pos = 0; pos < this->text.size(); )
+    {
+        size_t len = std::min<size_t>(this->text.size() - pos, ::UTF8_CHUNK_SIZE);
+
+        // A surrogate pair can't be split between chunks
+        if (pos + len < this->text.size() && this->text[pos + len - 1] >= 0xD800 && this->text[pos + len - 1] <= 0xDBFF)
+        {
+            len--;
+        }
+
+        this->utf8.append(chunk, Json::Utf16ToUtf8(this->text.data() + pos, len, chunk));
+        pos += len;
+    }
+
+    return this->utf8;
+}
+
+std::wstring Json::Writer::TakeText()
+{
+    return std::move(this->text);
+}
+
+size_t Json::Writer::GetSize(const Dict& dict)
+{
+    CountOutput output;
+    Json::WriteObject(dict, output);
+    return output.GetSize();
+}
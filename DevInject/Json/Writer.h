@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include "Json/Dict.h"
+
+namespace Json
+{
+    // Appends JSON text into one buffer. Keep a writer around and Clear() it to reuse
+    // the buffer for the next message instead of allocating a new one.
+    class Writer
+    {
+    public:
+        DEV_INJECT_API Writer();
+
+        DEV_INJECT_API void Clear();
+        // The exact size pre-pass walks the dict twice, it only pays off for big dicts written once
+        DEV_INJECT_API void Write(const Dict& dict, bool exactSize = false);
+        DEV_INJECT_API void Write(const Value& value);
+        DEV_INJECT_API void WriteString(std::wstring_view value);
+
+        // Writes an object one member at a time, without a Dict
+        DEV_INJECT_API void BeginObject();
+        DEV_INJECT_API void WriteKey(std::wstring_view key);
+        DEV_INJECT_API void EndObject();
+
+        DEV_INJECT_API std::wstring_view GetText() const;
+        DEV_INJECT_API std::string_view GetUtf8();
+        DEV_INJECT_API std::wstring TakeText();
+
+        // Exact length of the text that Write would append
+        DEV_INJECT_API static size_t GetSize(const Dict& dict);
+
+    private:
+        std::wstring text;
+        std::string utf8;
+    };
+}
@@ -4,6 +4,9 @@
 
 static const DWORD PIPE_BUFFER_SIZE = 65536;
 
+// Command frames are copied here before their ID is patched, bigger ones go on the heap
+static const size_t FRAME_BUFFER_SIZE = 512;
+
 static std::wstring GetPipeName(HANDLE serverProcess, HANDLE clientProcess)
 {
     std::wstringstream pipeName;
@@ -14,6 +17,12 @@ static std::wstring GetPipeName(HANDLE serverProcess, HANDLE clientProcess)
     return pipeName.str();
 }
 
+static int GetNextTransactionId()
+{
+    static long TRANSACTION_ID = 0;
+    return ::InterlockedIncrement(&TRANSACTION_ID);
+}
+
 Pipe::Pipe()
     : Pipe(nullptr, nullptr, nullptr)
 {
@@ -23,12 +32,18 @@ Pipe::Pipe(HANDLE pipe, HANDLE disposeEvent, HANDLE otherProcess)
     : pipe(pipe)
     , disposeEvent(disposeEvent)
     , otherProcess(otherProcess)
+    , format(Format::Json)
+    , lazy(false)
 {
 }
 
 Pipe::Pipe(Pipe&& rhs)
     : Pipe(rhs.pipe, rhs.disposeEvent, rhs.otherProcess)
 {
+    this->format = rhs.format;
+    this->lazy = rhs.lazy;
+    this->parseContext = std::move(rhs.parseContext);
+    this->writeContext = std::move(rhs.writeContext);
     rhs.pipe = nullptr;
 }
 
@@ -46,6 +61,10 @@ Pipe& Pipe::operator=(Pipe&& rhs)
         this->pipe = rhs.pipe;
         this->disposeEvent = rhs.disposeEvent;
         this->otherProcess = rhs.otherProcess;
+        this->format = rhs.format;
+        this->lazy = rhs.lazy;
+        this->parseContext = std::move(rhs.parseContext);
+        this->writeContext = std::move(rhs.writeContext);
 
         rhs.pipe = nullptr;
     }
@@ -119,6 +138,24 @@ void Pipe::Dispose()
     }
 }
 
+// Both processes must be from the same build to use Format::Binary
+void Pipe::SetFormat(Format format)
+{
+    this->format = format;
+}
+
+// Nested objects and arrays of messages read by this pipe are only parsed when they're used,
+// for readers that look at a few top level values and skip big ones like aliases
+void Pipe::SetLazyParsing(bool lazy)
+{
+    this->lazy = lazy;
+
+    if (this->parseContext)
+    {
+        this->parseContext->GetParser().SetLazy(lazy);
+    }
+}
+
 bool Pipe::WaitForClient() const
 {
     bool status = false;
@@ -162,32 +199,28 @@ bool Pipe::WaitForClient() const
     return status;
 }
 
-bool Pipe::ReadMessage(Json::Dict& input) const
+// Each chunk gets parsed as soon as it's read, the whole message never has to be in one buffer
+bool Pipe::ReadMessage(Json::ParseContext& context) const
 {
-    HANDLE oioEvent = ::CreateEvent(nullptr, TRUE, FALSE, nullptr);
-    std::vector<BYTE> buffer;
-    size_t readBufferSize = 0;
+    Json::ChunkParser& parser = context.GetParser();
     bool done = false;
+    parser.Reset();
 
     while (!done)
     {
-        buffer.resize(readBufferSize + ::PIPE_BUFFER_SIZE);
-
         bool moreData = false;
         DWORD bytesRead = 0;
         OVERLAPPED oio{};
-        oio.hEvent = oioEvent;
+        oio.hEvent = context.GetEvent();
 
-        if (::ReadFile(this->pipe, buffer.data() + readBufferSize, ::PIPE_BUFFER_SIZE, nullptr, &oio) || ::GetLastError() == ERROR_MORE_DATA)
+        if (::ReadFile(this->pipe, context.GetBuffer(), context.GetBufferSize(), nullptr, &oio) || ::GetLastError() == ERROR_MORE_DATA)
         {
             if (::GetOverlappedResult(this->pipe, &oio, &bytesRead, TRUE))
             {
-                readBufferSize += bytesRead;
                 done = true;
             }
             else if (::GetLastError() == ERROR_MORE_DATA)
             {
-                readBufferSize += bytesRead;
                 moreData = true;
             }
             else
@@ -202,12 +235,10 @@ bool Pipe::ReadMessage(Json::Dict& input) const
             {
                 if (::GetOverlappedResult(this->pipe, &oio, &bytesRead, TRUE))
                 {
-                    readBufferSize += bytesRead;
                     done = true;
                 }
                 else if (::GetLastError() == ERROR_MORE_DATA)
                 {
-                    readBufferSize += bytesRead;
                     moreData = true;
                 }
                 else
@@ -221,27 +252,65 @@ bool Pipe::ReadMessage(Json::Dict& input) const
         {
             break;
         }
+
+        // Keeps reading after a parse error, the rest of the message still has to come out of the pipe
+        parser.Feed(context.GetBuffer(), bytesRead);
     }
 
     if (done)
     {
-        input = Json::Parse(reinterpret_cast<const wchar_t*>(buffer.data()), readBufferSize - sizeof(wchar_t));
+        parser.Finish();
     }
 
-    ::CloseHandle(oioEvent);
-
     return done;
 }
 
+// The reply shares the pipe's arena, which is reused by the next read once the reply is gone
+bool Pipe::ReadMessage(Json::Dict& input) const
+{
+    Json::ParseContext& context = this->GetParseContext();
+
+    if (this->ReadMessage(context))
+    {
+        input = context.GetParser().GetDocument().GetRoot();
+        return true;
+    }
+
+    return false;
+}
+
 bool Pipe::WriteMessage(const Json::Dict& output) const
+{
+    return this->WriteMessage(output, this->GetWriteContext(), this->format);
+}
+
+// Messages are sent as UTF-8, which is half the size of UTF-16 for the mostly ASCII payloads.
+// The writers' buffers are reused for every message written with the same context.
+bool Pipe::WriteMessage(const Json::Dict& output, Json::WriteContext& context, Format format) const
+{
+    if (format == Format::Binary)
+    {
+        Json::BinaryWriter& writer = context.GetBinaryWriter();
+        writer.Write(output);
+        return this->WriteBytes(writer.GetData(), writer.GetSize(), context.GetEvent());
+    }
+
+    Json::Writer& writer = context.GetWriter();
+    writer.Clear();
+    writer.Write(output);
+    std::string_view buffer = writer.GetUtf8();
+    return this->WriteBytes(buffer.data(), buffer.size(), context.GetEvent());
+}
+
+// The event is reset by WriteFile, so the same one works for every write
+bool Pipe::WriteBytes(const void* data, size_t size, HANDLE event) const
 {
     bool status = false;
-    std::wstring buffer = Json::Write(output);
-    DWORD byteSize = static_cast<DWORD>((buffer.size() + 1) * sizeof(wchar_t));
+    DWORD byteSize = static_cast<DWORD>(size);
     OVERLAPPED oio{};
-    oio.hEvent = ::CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    oio.hEvent = event;
 
-    if (::WriteFile(this->pipe, buffer.c_str(), byteSize, nullptr, &oio))
+    if (::WriteFile(this->pipe, data, byteSize, nullptr, &oio))
     {
         status = true;
     }
@@ -258,23 +327,35 @@ bool Pipe::WriteMessage(const Json::Dict& output) const
         assert(!status || bytesWritten == byteSize);
     }
 
-    ::CloseHandle(oio.hEvent);
-
     return status;
 }
 
 void Pipe::RunServer(const Json::MessageHandler& handler) const
+{
+    Json::ParseContext parseContext;
+    parseContext.GetParser().SetLazy(this->lazy);
+    Json::WriteContext writeContext;
+    this->RunServer(handler, parseContext, writeContext);
+}
+
+// The parser's arena is reused for the next message unless the handler kept part of the input.
+// When the handler replies with nothing, the context's reply is reused too.
+void Pipe::RunServer(const Json::MessageHandler& handler, Json::ParseContext& parseContext, Json::WriteContext& writeContext) const
 {
     for (bool status = (this->pipe != nullptr); status; )
     {
-        Json::Dict input;
-        if ((status = this->ReadMessage(input)) != false)
+        if ((status = this->ReadMessage(parseContext)) != false)
         {
+            const Json::Dict& input = parseContext.GetParser().GetDocument().GetRoot();
+            Format inputFormat = parseContext.GetParser().IsBinary() ? Format::Binary : Format::Json;
+
             Json::Dict output = handler(input);
-            output.Set(PIPE_PROPERTY_ID, input.Get(PIPE_PROPERTY_ID));
-            output.Set(PIPE_PROPERTY_COMMAND, input.Get(PIPE_PROPERTY_COMMAND));
+            Json::Dict& reply = output.Size() ? output : writeContext.GetReply();
+            reply.Set(Json::Keys::Id, input.Get(Json::Keys::Id));
+            reply.Set(Json::Keys::Command, input.Get(Json::Keys::Command));
 
-            status = this->WriteMessage(output);
+            status = this->WriteMessage(reply, writeContext, inputFormat);
+            writeContext.GetReply().Clear();
         }
     }
 
@@ -287,19 +368,17 @@ void Pipe::RunServer(const Json::MessageHandler& handler) const
 bool Pipe::Transact(const Json::Dict& input, Json::Dict& output) const
 {
     Json::Dict inputCopy = input;
-    if (inputCopy.Get(PIPE_PROPERTY_ID).IsUnset())
+    if (inputCopy.Get(Json::Keys::Id).IsUnset())
     {
-        static long TRANSACTION_ID = 0;
-        int id = ::InterlockedIncrement(&TRANSACTION_ID);
-        inputCopy.Set(PIPE_PROPERTY_ID, Json::Value(id));
+        inputCopy.Set(Json::Keys::Id, Json::Value(::GetNextTransactionId()));
     }
 
     if (this->WriteMessage(inputCopy))
     {
         if (this->ReadMessage(output))
         {
-            assert(inputCopy.Get(PIPE_PROPERTY_ID) == output.Get(PIPE_PROPERTY_ID));
-            assert(inputCopy.Get(PIPE_PROPERTY_COMMAND) == output.Get(PIPE_PROPERTY_COMMAND));
+            assert(inputCopy.Get(Json::Keys::Id) == output.Get(Json::Keys::Id));
+            assert(inputCopy.Get(Json::Keys::Command) == output.Get(Json::Keys::Command));
             return true;
         }
 
@@ -312,12 +391,73 @@ bool Pipe::Transact(const Json::Dict& input, Json::Dict& output) const
     return false;
 }
 
+// The frame is already written, so only its ID changes
+bool Pipe::Transact(const Json::Frame& input, Json::Dict& output) const
+{
+    int id = ::GetNextTransactionId();
+    size_t size = (this->format == Format::Binary) ? input.GetBinarySize() : input.GetUtf8Size();
+    std::array<BYTE, ::FRAME_BUFFER_SIZE> stackBuffer;
+    std::vector<BYTE> heapBuffer;
+    BYTE* buffer = stackBuffer.data();
+
+    if (size > stackBuffer.size())
+    {
+        heapBuffer.resize(size);
+        buffer = heapBuffer.data();
+    }
+
+    if (this->format == Format::Binary)
+    {
+        input.CopyBinary(id, buffer);
+    }
+    else
+    {
+        input.CopyUtf8(id, reinterpret_cast<char*>(buffer));
+    }
+
+    if (this->WriteBytes(buffer, size, this->GetWriteContext().GetEvent()))
+    {
+        if (this->ReadMessage(output))
+        {
+            assert(Json::Value(id) == output.Get(Json::Keys::Id));
+            return true;
+        }
+
+        assert(L"Failed getting pipe reply");
+        return false;
+    }
+
+    return false;
+}
+
 bool Pipe::Send(const Json::Dict& input) const
 {
     Json::Dict response;
     return this->Transact(input, response);
 }
 
+// Made on first use, since a server pipe reads and writes with the contexts passed to RunServer
+Json::ParseContext& Pipe::GetParseContext() const
+{
+    if (!this->parseContext)
+    {
+        this->parseContext = std::make_unique<Json::ParseContext>();
+        this->parseContext->GetParser().SetLazy(this->lazy);
+    }
+
+    return *this->parseContext;
+}
+
+Json::WriteContext& Pipe::GetWriteContext() const
+{
+    if (!this->writeContext)
+    {
+        this->writeContext = std::make_unique<Json::WriteContext>();
+    }
+
+    return *this->writeContext;
+}
+
 std::array<HANDLE, 3> Pipe::GetWaitHandles(const OVERLAPPED& oio) const
 {
     return std::array<HANDLE, 3>
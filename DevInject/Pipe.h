@@ -1,13 +1,27 @@
 ﻿#pragma once
 
 #include "Api.h"
+#include "Json/Binary.h"
+#include "Json/ChunkParser.h"
+#include "Json/Context.h"
+#include "Json/Document.h"
+#include "Json/Frame.h"
 #include "Json/Message.h"
+#include "Json/Writer.h"
 
 // Helper class for sending info back and forth through pipes. When a dispose event
 // gets set, then the pipe will stop doing work.
 class Pipe
 {
 public:
+    // How messages get written. Reading always accepts any format, and the server
+    // replies in the format of each request.
+    enum class Format
+    {
+        Json,
+        Binary,
+    };
+
     DEV_INJECT_API Pipe();
     DEV_INJECT_API Pipe(Pipe&& rhs);
     DEV_INJECT_API ~Pipe();
@@ -19,20 +33,35 @@ public:
     DEV_INJECT_API static Pipe Create(HANDLE clientProcess, HANDLE disposeEvent);
     DEV_INJECT_API static Pipe Connect(HANDLE serverProcess, HANDLE disposeEvent);
     DEV_INJECT_API void Dispose();
+    DEV_INJECT_API void SetFormat(Format format);
+    DEV_INJECT_API void SetLazyParsing(bool lazy);
 
     DEV_INJECT_API bool WaitForClient() const;
     DEV_INJECT_API void RunServer(const Json::MessageHandler& handler) const;
+    DEV_INJECT_API void RunServer(const Json::MessageHandler& handler, Json::ParseContext& parseContext, Json::WriteContext& writeContext) const;
     DEV_INJECT_API bool Transact(const Json::Dict& input, Json::Dict& output) const;
+    DEV_INJECT_API bool Transact(const Json::Frame& input, Json::Dict& output) const;
     DEV_INJECT_API bool Send(const Json::Dict& input) const;
 
 private:
     Pipe(HANDLE pipe, HANDLE disposeEvent, HANDLE otherProcess);
 
     std::array<HANDLE, 3> GetWaitHandles(const OVERLAPPED& oio) const;
+    bool ReadMessage(Json::ParseContext& context) const;
     bool ReadMessage(Json::Dict& input) const;
     bool WriteMessage(const Json::Dict& output) const;
+    bool WriteMessage(const Json::Dict& output, Json::WriteContext& context, Format format) const;
+    bool WriteBytes(const void* data, size_t size, HANDLE event) const;
+    Json::ParseContext& GetParseContext() const;
+    Json::WriteContext& GetWriteContext() const;
 
     HANDLE pipe;
     HANDLE disposeEvent;
     HANDLE otherProcess;
+    Format format;
+    bool lazy;
+
+    // For Transact and Send, which callers already lock around since a pipe has one message in flight
+    mutable std::unique_ptr<Json::ParseContext> parseContext;
+    mutable std::unique_ptr<Json::WriteContext> writeContext;
 };
@@ -6,14 +6,23 @@
 #include <Psapi.h>
 
 // C++
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <charconv>
+#include <cmath>
 #include <functional>
+#include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <thread>
+#include <tuple>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 // Defines
 #undef MAX_PATH
@@ -0,0 +1,445 @@
+﻿#include "stdafx.h"
+#include "Json/Binary.h"
+#include "Json/ChunkParser.h"
+#include "Json/Message.h"
+#include "Json/Persist.h"
+#include "Json/Writer.h"
+
+// Times the Json library on messages shaped like the ones the pipes send.
+// The Json sources are built right into this exe, so the allocation counts include theirs.
+// Usage: DevJsonBench [seconds per test]
+
+static const double DEFAULT_SECONDS = 0.25;
+
+// Same size as the pipe's read buffer, so chunked parsing is fed the way the pipe feeds it
+static const size_t CHUNK_SIZE = 4096;
+
+// Stays under the parser's default depth limit
+static const size_t NESTING_DEPTH = 60;
+
+static std::atomic<size_t> allocCount;
+
+void* operator new(size_t size)
+{
+    ::allocCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* data = std::malloc(size ? size : 1))
+    {
+        return data;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* data) noexcept
+{
+    std::free(data);
+}
+
+void operator delete(void* data, size_t) noexcept
+{
+    std::free(data);
+}
+
+// The short messages of a console's life, in the order ConsoleProcess and DevInject send them
+struct ReplayMessage
+{
+    const wchar_t* command;
+    bool hwnd;
+};
+
+static const ReplayMessage REPLAY_MESSAGES[] =
+{
+    { PIPE_COMMAND_PIPE_CREATED, false },
+    { PIPE_COMMAND_CONHOST_INJECTED, false },
+    { PIPE_COMMAND_WINDOW_CREATED, true },
+    { PIPE_COMMAND_GET_STATE, false },
+    { PIPE_COMMAND_CHECK_WINDOW_SIZE, false },
+    { PIPE_COMMAND_ACTIVATED, false },
+    { PIPE_COMMAND_CHECK_WINDOW_DPI, false },
+    { PIPE_COMMAND_CHECK_WINDOW_SIZE, false },
+    { PIPE_COMMAND_DEACTIVATED, false },
+    { PIPE_COMMAND_ACTIVATED, false },
+    { PIPE_COMMAND_DETACH, false },
+    { PIPE_COMMAND_CLOSED, false },
+};
+
+struct Message
+{
+    const char* name;
+    Json::Dict dict;
+    std::wstring text;
+    std::string utf8;
+    std::vector<BYTE> binary;
+};
+
+static std::wstring MakePath(size_t index, size_t parts)
+{
+    std::wstring path;
+
+    for (size_t i = 0; i < parts; i++)
+    {
+        if (i)
+        {
+            path.push_back(L';');
+        }
+
+        path.append(L"C:\\Program Files\\Vendor Tool ");
+        path.append(std::to_wstring(index * 31 + i));
+        path.append(L"\\bin");
+    }
+
+    return path;
+}
+
+// Like a Visual Studio developer prompt: a few long paths and a lot of short settings
+static Json::Dict MakeEnvironment()
+{
+    Json::Dict env;
+    env.Set(L"ALLUSERSPROFILE", Json::Value(L"C:\\ProgramData"));
+    env.Set(L"COMPUTERNAME", Json::Value(L"DEVBOX"));
+    env.Set(L"ComSpec", Json::Value(L"C:\\Windows\\system32\\cmd.exe"));
+    env.Set(L"INCLUDE", Json::Value(::MakePath(1, 12)));
+    env.Set(L"LIB", Json::Value(::MakePath(2, 8)));
+    env.Set(L"PATH", Json::Value(::MakePath(3, 40)));
+    env.Set(L"PATHEXT", Json::Value(L".COM;.EXE;.BAT;.CMD;.VBS;.VBE;.JS;.JSE;.WSF;.WSH;.MSC"));
+    env.Set(L"PROCESSOR_ARCHITECTURE", Json::Value(L"AMD64"));
+    env.Set(L"USERPROFILE", Json::Value(L"C:\\Users\\developer"));
+    env.Set(L"windir", Json::Value(L"C:\\Windows"));
+
+    for (size_t i = env.Size(); i < 300; i++)
+    {
+        std::wstring name = L"VSCMD_SETTING_" + std::to_wstring(i);
+        env.Set(name, Json::Value((i % 5) ? std::to_wstring(i * 7919) : ::MakePath(i, 2)));
+    }
+
+    return env;
+}
+
+// Like doskey /macros:all, a dict of aliases for each exe
+static Json::Dict MakeAliases()
+{
+    const wchar_t* exes[] = { L"cmd.exe", L"powershell.exe", L"git.exe" };
+    Json::Dict aliases;
+
+    for (size_t i = 0; i < _countof(exes); i++)
+    {
+        Json::Dict exeAliases;
+
+        for (size_t h = 0; h < 40; h++)
+        {
+            std::wstring name = L"alias" + std::to_wstring(i * 100 + h);
+            std::wstring value = L"git log --oneline --graph -n " + std::to_wstring(h) + L" $*";
+            exeAliases.Set(name, Json::Value(std::move(value)));
+        }
+
+        aliases.Set(exes[i], Json::Value(std::move(exeAliases)));
+    }
+
+    return aliases;
+}
+
+static Json::Value MakeNested(size_t depth)
+{
+    if (!depth)
+    {
+        return Json::Value(L"leaf");
+    }
+
+    Json::Value child = ::MakeNested(depth - 1);
+
+    if (depth % 2)
+    {
+        std::pmr::vector<Json::Value> values;
+        values.push_back(Json::Value(static_cast<int>(depth)));
+        values.push_back(std::move(child));
+        return Json::Value(std::move(values));
+    }
+
+    Json::Dict dict;
+    dict.Set(L"depth", Json::Value(static_cast<int>(depth)));
+    dict.Set(L"child", std::move(child));
+    return Json::Value(std::move(dict));
+}
+
+// Quotes, backslashes, control chars and non-ASCII, so nearly every char needs work
+static std::wstring MakeEscapes(size_t index)
+{
+    std::wstring value = L"\"C:\\Users\\dev\\" + std::to_wstring(index) + L"\"\t";
+    value.append(L"line\r\nnext\x0001\x001f caf\x00e9 \x4e2d\x6587 \xd83d\xde00 \\\\server\\share\"");
+    return value;
+}
+
+static Message MakeMessage(const char* name, Json::Dict&& dict)
+{
+    Message message;
+    message.name = name;
+    message.dict = std::move(dict);
+    message.text = Json::Write(message.dict);
+    message.utf8 = Json::WriteUtf8(message.dict);
+
+    Json::BinaryWriter writer;
+    writer.Write(message.dict);
+    message.binary.assign(writer.GetData(), writer.GetData() + writer.GetSize());
+
+    return message;
+}
+
+static std::vector<Message> MakeCorpus()
+{
+    std::vector<Message> corpus;
+
+    Json::Dict command = Json::CreateMessage(PIPE_COMMAND_CHECK_WINDOW_SIZE);
+    command.Set(Json::Keys::Id, Json::Value(12));
+    command.Set(Json::Keys::Hwnd, Json::Value(0x1234));
+    corpus.push_back(::MakeMessage("command", std::move(command)));
+
+    Json::Dict state = Json::CreateMessage(PIPE_COMMAND_STATE_CHANGED);
+    state.Set(Json::Keys::Id, Json::Value(3));
+    state.Set(Json::Keys::Title, Json::Value(L"Developer Command Prompt"));
+    state.Set(Json::Keys::Directory, Json::Value(L"C:\\Users\\developer\\source\\repos"));
+    state.Set(Json::Keys::Environment, Json::Value(::MakeEnvironment()));
+    corpus.push_back(::MakeMessage("environment", std::move(state)));
+
+    Json::Dict aliases = Json::CreateMessage(PIPE_COMMAND_STATE_CHANGED);
+    aliases.Set(Json::Keys::Aliases, Json::Value(::MakeAliases()));
+    corpus.push_back(::MakeMessage("aliases", std::move(aliases)));
+
+    Json::Dict nested = Json::CreateMessage(PIPE_COMMAND_SET_STATE);
+    nested.Set(L"Nested", ::MakeNested(::NESTING_DEPTH));
+    corpus.push_back(::MakeMessage("nesting", std::move(nested)));
+
+    std::pmr::vector<Json::Value> arguments;
+    for (size_t i = 0; i < 64; i++)
+    {
+        arguments.push_back(Json::Value(::MakeEscapes(i)));
+    }
+
+    Json::Dict escapes = Json::CreateMessage(PIPE_COMMAND_SET_STATE);
+    escapes.Set(Json::Keys::Arguments, Json::Value(std::move(arguments)));
+    corpus.push_back(::MakeMessage("escapes", std::move(escapes)));
+
+    return corpus;
+}
+
+// Runs a test until the time is up and prints one line. The results are summed so the test can't be optimized away.
+// Tests without a byte count, like dict lookups, show zero MB/s. A test can handle more than one message per call.
+static void Run(const char* name, const char* test, size_t bytes, double seconds, const std::function<size_t()>& func, size_t messages = 1)
+{
+    typedef std::chrono::steady_clock Clock;
+    static volatile size_t sink = 0;
+
+    // Once first, so that reused buffers have grown and only the steady state gets counted
+    sink += func();
+
+    size_t count = 0;
+    size_t allocs = ::allocCount.load();
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start;
+
+    for (size_t batch = 1; std::chrono::duration<double>(end - start).count() < seconds; batch *= 2)
+    {
+        for (size_t i = 0; i < batch; i++)
+        {
+            sink += func();
+        }
+
+        count += batch;
+        end = Clock::now();
+    }
+
+    allocs = ::allocCount.load() - allocs;
+
+    count *= messages;
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / count;
+    double mbs = (bytes / 1048576.0) / (ns / 1e9);
+    std::printf("%-12s %-20s %9zu %12.0f %10.1f %10.2f\n", name, test, bytes, ns, mbs, static_cast<double>(allocs) / count);
+}
+
+static size_t FeedChunks(Json::ChunkParser& parser, const void* data, size_t size)
+{
+    const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+
+    for (size_t i = 0; i < size; i += ::CHUNK_SIZE)
+    {
+        if (!parser.Feed(bytes + i, std::min<size_t>(::CHUNK_SIZE, size - i)))
+        {
+            return 0;
+        }
+    }
+
+    return parser.Finish() ? parser.GetDocument().GetRoot().Size() : 0;
+}
+
+// Builds, writes and parses one message the way the pipes do, so the allocation count covers the whole trip.
+// Command names up to Value::SHORT_STRING_SIZE chars and HWNDs are stored inline.
+static size_t Replay(Json::Writer& writer, Json::ChunkParser& parser, const ReplayMessage& replay)
+{
+    Json::Dict message = Json::CreateMessage(replay.command);
+    if (replay.hwnd)
+    {
+        message.Set(Json::Keys::Hwnd, Json::Value(reinterpret_cast<HWND>(0x000a0f36)));
+    }
+
+    writer.Clear();
+    writer.Write(message);
+    std::string_view utf8 = writer.GetUtf8();
+
+    parser.ResetUtf8();
+    if (!::FeedChunks(parser, utf8.data(), utf8.size()))
+    {
+        return 0;
+    }
+
+    const Json::Dict& root = parser.GetDocument().GetRoot();
+    return root.Get(Json::Keys::Command).GetString().size() + (root.Get(Json::Keys::Hwnd).TryGetHwnd() != nullptr);
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = (argc > 1) ? std::atof(argv[1]) : ::DEFAULT_SECONDS;
+    if (seconds <= 0)
+    {
+        seconds = ::DEFAULT_SECONDS;
+    }
+
+    std::vector<Message> corpus = ::MakeCorpus();
+    Json::Writer writer;
+    Json::BinaryWriter binaryWriter;
+    Json::ChunkParser parser;
+
+    std::printf("%-12s %-20s %9s %12s %10s %10s\n", "message", "test", "bytes", "ns/message", "MB/s", "allocs");
+
+    for (const Message& message : corpus)
+    {
+        const wchar_t* text = message.text.c_str();
+        size_t textLength = message.text.size();
+        size_t textBytes = textLength * sizeof(wchar_t);
+
+        ::Run(message.name, "Parse", textBytes, seconds, [&]()
+            {
+                return Json::Parse(text, textLength).Size();
+            });
+
+        ::Run(message.name, "ParseDocument", textBytes, seconds, [&]()
+            {
+                return Json::ParseDocument(text, textLength).GetRoot().Size();
+            });
+
+        ::Run(message.name, "ParseDocumentLazy", textBytes, seconds, [&]()
+            {
+                return Json::ParseDocumentLazy(text, textLength).GetRoot().Size();
+            });
+
+        ::Run(message.name, "ParseUtf8", message.utf8.size(), seconds, [&]()
+            {
+                return Json::ParseUtf8(message.utf8.c_str(), message.utf8.size()).Size();
+            });
+
+        ::Run(message.name, "ChunkParser UTF-8", message.utf8.size(), seconds, [&]()
+            {
+                parser.ResetUtf8();
+                return ::FeedChunks(parser, message.utf8.c_str(), message.utf8.size());
+            });
+
+        ::Run(message.name, "ChunkParser binary", message.binary.size(), seconds, [&]()
+            {
+                parser.Reset();
+                return ::FeedChunks(parser, message.binary.data(), message.binary.size());
+            });
+
+        ::Run(message.name, "BinaryValue", message.binary.size(), seconds, [&]()
+            {
+                Json::BinaryValue root = Json::BinaryValue::GetRoot(message.binary.data(), message.binary.size());
+                return root.Get(Json::Keys::Command.GetName()).GetUtf8().size() + root.Size();
+            });
+
+        ::Run(message.name, "Write", textBytes, seconds, [&]()
+            {
+                return Json::Write(message.dict).size();
+            });
+
+        ::Run(message.name, "WriteUtf8", message.utf8.size(), seconds, [&]()
+            {
+                return Json::WriteUtf8(message.dict).size();
+            });
+
+        ::Run(message.name, "Writer UTF-8", message.utf8.size(), seconds, [&]()
+            {
+                writer.Clear();
+                writer.Write(message.dict);
+                return writer.GetUtf8().size();
+            });
+
+        ::Run(message.name, "BinaryWriter", message.binary.size(), seconds, [&]()
+            {
+                binaryWriter.Write(message.dict);
+                return binaryWriter.GetSize();
+            });
+
+        ::Run(message.name, "Dict copy", 0, seconds, [&]()
+            {
+                Json::Dict copy = message.dict;
+                return copy.Size();
+            });
+
+        ::Run(message.name, "Dict copy and set", 0, seconds, [&]()
+            {
+                Json::Dict copy = message.dict;
+                copy.Set(Json::Keys::Id, Json::Value(4));
+                return copy.Size();
+            });
+    }
+
+    // Allocations per message for the replay, most messages are just a command name
+    ::Run("replay", "Build, write, parse", 0, seconds, [&]()
+        {
+            size_t total = 0;
+            for (const ReplayMessage& replay : ::REPLAY_MESSAGES)
+            {
+                total += ::Replay(writer, parser, replay);
+            }
+
+            return total;
+        }, _countof(::REPLAY_MESSAGES));
+
+    // Environment blocks and doskey macros are read as name=value pairs before they become dicts
+    const Json::Value& environment = corpus[1].dict.Get(Json::Keys::Environment);
+    const Json::Value& aliases = corpus[2].dict.Get(Json::Keys::Aliases).GetDict().Get(L"cmd.exe");
+    std::pair<const char*, std::wstring> blocks[] =
+    {
+        { "environment", Json::WriteNameValuePairs(environment.GetDict(), L'\0') },
+        { "aliases", Json::WriteNameValuePairs(aliases.GetDict(), L'\0') },
+    };
+
+    for (const std::pair<const char*, std::wstring>& block : blocks)
+    {
+        const wchar_t* text = block.second.c_str();
+
+        ::Run(block.first, "ParseNameValuePairs", block.second.size() * sizeof(wchar_t), seconds, [&]()
+            {
+                return Json::ParseNameValuePairs(text, L'\0').Size();
+            });
+    }
+
+    // Finding every variable of a big dict
+    const Json::Dict& env = environment.GetDict();
+    std::vector<std::wstring> names;
+    for (const Json::Dict::EntryType& i : env)
+    {
+        names.emplace_back(i.first);
+    }
+
+    ::Run("environment", "Dict find all", 0, seconds, [&]()
+        {
+            size_t found = 0;
+            for (const std::wstring& name : names)
+            {
+                found += (env.Find(name) != nullptr);
+            }
+
+            return found;
+        });
+
+    return 0;
+}
@@ -0,0 +1,8 @@
+﻿#pragma once
+
+// The Json sources are built into this exe, so they need everything DevInject's header has
+#include "../DevInject/stdafx.h"
+
+// C++
+#include <chrono>
+#include <cstdio>
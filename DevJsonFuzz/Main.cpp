@@ -0,0 +1,156 @@
+﻿#include "stdafx.h"
+#include "Json/Binary.h"
+#include "Json/ChunkParser.h"
+#include "Json/Persist.h"
+#include "Json/Scan.h"
+#include "Json/Utf8.h"
+#include "Json/Writer.h"
+
+// libFuzzer entry point. Any input that parses must write out and parse back to the same thing,
+// whether it goes through UTF-8, UTF-16, the binary format or chunked parsing.
+// Numbers can change type once, 1.0 writes as 1 and reads back as an int,
+// so the check is that the second write matches the first.
+// Lazy parsing must accept the same text as eager parsing.
+// The SIMD scans are checked against the scalar scan on the same bytes.
+
+static void Check(bool condition)
+{
+    if (!condition)
+    {
+        std::abort();
+    }
+}
+
+static void CheckRoundTrip(const Json::Dict& dict)
+{
+    std::wstring text = Json::Write(dict);
+    size_t errorPos = 0;
+    Json::Dict parsed = Json::Parse(text.c_str(), text.size(), &errorPos);
+    ::Check(errorPos == std::wstring::npos);
+    ::Check(Json::Write(parsed) == text);
+
+    std::string utf8 = Json::WriteUtf8(parsed);
+    Json::Dict parsedUtf8 = Json::ParseUtf8(utf8.c_str(), utf8.size(), &errorPos);
+    ::Check(errorPos == std::wstring::npos);
+    ::Check(parsedUtf8 == parsed);
+
+    Json::BinaryWriter writer;
+    writer.Write(parsed);
+    ::Check(Json::BinaryValue::IsBinary(writer.GetData(), writer.GetSize()));
+    ::Check(Json::ParseBinary(writer.GetData(), writer.GetSize()) == parsed);
+
+    // Lazy values get parsed when they're compared or written
+    Json::Document lazy = Json::ParseDocumentLazy(text.c_str(), text.size(), &errorPos);
+    ::Check(errorPos == std::wstring::npos);
+    ::Check(Json::Write(lazy.GetRoot()) == text);
+}
+
+// Lazy parsing must fail at the same place as eager parsing, not later when a nested value is used
+static void CheckLazy(const std::wstring& text)
+{
+    size_t errorPos = 0;
+    Json::Document eager = Json::ParseDocument(text.c_str(), text.size(), &errorPos);
+
+    size_t lazyErrorPos = 0;
+    Json::Document lazy = Json::ParseDocumentLazy(text.c_str(), text.size(), &lazyErrorPos);
+    ::Check(lazyErrorPos == errorPos);
+
+    if (errorPos == std::wstring::npos)
+    {
+        ::Check(Json::Write(lazy.GetRoot()) == Json::Write(eager.GetRoot()));
+    }
+}
+
+// Splits the input in two, which is enough to land on every kind of chunk boundary over many runs.
+// The lazy parser must fail at the same place, and its values must parse to the same thing when used.
+static void CheckChunks(const BYTE* data, size_t size, const Json::Dict* expected)
+{
+    std::array<Json::ChunkParser, 2> parsers;
+    parsers[1].SetLazy(true);
+    size_t split = size ? (data[0] % size) : 0;
+
+    for (Json::ChunkParser& parser : parsers)
+    {
+        parser.ResetUtf8();
+
+        bool result = parser.Feed(data, split) && parser.Feed(data + split, size - split) && parser.Finish();
+        ::Check(result == (expected != nullptr));
+        ::Check(parser.GetErrorPos() == parsers[0].GetErrorPos());
+
+        if (expected)
+        {
+            ::Check(parser.GetDocument().GetRoot() == *expected);
+        }
+    }
+}
+
+// Longer than one AVX2 step plus one SSE2 step, so every start and tail length covers a vector and the scalar tail
+static const size_t SCAN_EDGE = 24;
+
+// Each SIMD scan must stop at the same char as the scalar scan, from every start and with every tail length
+static void CheckScans(const std::wstring& text)
+{
+    static const std::vector<Json::ScanFunctions> functions = Json::GetAllScanFunctions();
+    const wchar_t* chars = text.c_str();
+    size_t size = text.size();
+
+    for (size_t start = 0; start <= std::min(size, ::SCAN_EDGE); start++)
+    {
+        for (size_t end = std::max(start, size - std::min(size, ::SCAN_EDGE)); end <= size; end++)
+        {
+            const wchar_t* begin = chars + start;
+            const wchar_t* stop = chars + end;
+            const Json::ScanFunctions& scalar = functions.front();
+
+            for (const Json::ScanFunctions& scan : functions)
+            {
+                ::Check(scan.stringChars(begin, stop) == scalar.stringChars(begin, stop));
+                ::Check(scan.spaces(begin, stop) == scalar.spaces(begin, stop));
+                ::Check(scan.digits(begin, stop) == scalar.digits(begin, stop));
+            }
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+    size_t errorPos = 0;
+
+    // Binary messages come from another process too, a bad one must only read as unset values
+    if (Json::BinaryValue::IsBinary(bytes, size))
+    {
+        Json::Dict dict = Json::ParseBinary(bytes, size);
+        ::CheckRoundTrip(dict);
+        return 0;
+    }
+
+    // Copied so that it ends in a null, the parser takes a zero length to mean null terminated
+    std::string input(reinterpret_cast<const char*>(bytes), size);
+    Json::Dict utf8 = Json::ParseUtf8(input.c_str(), input.size(), &errorPos);
+    bool utf8Parsed = (errorPos == std::wstring::npos);
+    if (utf8Parsed)
+    {
+        ::CheckRoundTrip(utf8);
+    }
+
+    ::CheckChunks(bytes, size, utf8Parsed ? &utf8 : nullptr);
+
+    std::wstring utf8Text(size, L'\0');
+    utf8Text.resize(Json::Utf8ToUtf16(input.c_str(), input.size(), &utf8Text[0]));
+    ::CheckLazy(utf8Text);
+
+    // The same bytes as UTF-16, unpaired surrogates and all
+    std::wstring text(size / sizeof(wchar_t), L'\0');
+    std::memcpy(&text[0], bytes, text.size() * sizeof(wchar_t));
+    ::CheckScans(text);
+    ::CheckLazy(text);
+
+    Json::Dict utf16 = Json::Parse(text.c_str(), text.size(), &errorPos);
+    if (errorPos == std::wstring::npos)
+    {
+        ::CheckRoundTrip(utf16);
+    }
+
+    return 0;
+}
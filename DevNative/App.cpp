@@ -514,7 +514,7 @@ void App::ProcessHostWindowDpiChanged(HWND hwnd)
     }, true);
 }
 
-HWND App::RunProcess(HWND processHostWindow, const Json::Dict& info)
+HWND App::RunProcess(HWND processHostWindow, std::wstring&& state)
 {
     assert(App::IsMainThread());
 
@@ -523,7 +523,7 @@ HWND App::RunProcess(HWND processHostWindow, const Json::Dict& info)
     assert(process->GetHostWindow());
 
     this->processes.push_back(process);
-    if (process->Start(info))
+    if (process->Start(std::move(state)))
     {
         Microsoft::WRL::ComPtr<IProcess> processInterop = new ProcessInterop(this, process->GetHostWindow());
         this->host->OnProcessOpening(processInterop.Get(), VARIANT_TRUE, nullptr);
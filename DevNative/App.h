@@ -44,7 +44,7 @@ public:
     void HideProcessHostWindow(HWND hwnd);
 
     // Process functions, each process is identified by its HWND
-    HWND RunProcess(HWND processHostWindow, const Json::Dict& info);
+    HWND RunProcess(HWND processHostWindow, std::wstring&& state);
     HWND CloneProcess(HWND processHostWindow, HWND hwnd);
     HWND AttachProcess(HWND processHostWindow, HANDLE handle, bool activate);
     void ActivateProcess(HWND hwnd);
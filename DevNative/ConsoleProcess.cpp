@@ -2,15 +2,73 @@
 #include "App.h"
 #include "ConsoleProcess.h"
 #include "DevPrompt_h.h"
+#include "Json/Binding.h"
+#include "Json/Document.h"
+#include "Json/Patch.h"
 #include "Json/Persist.h"
+#include "Json/Reader.h"
+#include "Json/State.h"
 #include "Utility.h"
 
+// What BackgroundStart needs out of the start info, the rest is sent on to the new process in a SetState command
+struct LaunchInfo
+{
+    std::wstring executable;
+    std::wstring arguments;
+    std::wstring directory;
+    Json::Dict environment;
+    Json::Value aliases;
+    Json::ConsoleColors colors;
+    Json::Value title;
+
+    static auto Fields()
+    {
+        return std::make_tuple(
+            Json::MakeField(Json::Keys::Executable, &LaunchInfo::executable),
+            Json::MakeField(Json::Keys::Arguments, &LaunchInfo::arguments),
+            Json::MakeField(Json::Keys::Directory, &LaunchInfo::directory),
+            Json::MakeField(Json::Keys::Environment, &LaunchInfo::environment),
+            Json::MakeField(Json::Keys::Aliases, &LaunchInfo::aliases),
+            Json::MakeField(Json::Keys::Colors, &LaunchInfo::colors),
+            Json::MakeField(Json::Keys::Title, &LaunchInfo::title));
+    }
+};
+
+// Frames for the commands that are sent without properties. They're looked up once, so sending one doesn't lock anything.
+struct CommandFrames
+{
+    const Json::Frame& activated;
+    const Json::Frame& checkWindowDpi;
+    const Json::Frame& checkWindowSize;
+    const Json::Frame& closed;
+    const Json::Frame& deactivated;
+    const Json::Frame& detach;
+    const Json::Frame& getState;
+};
+
+static const CommandFrames& GetCommandFrames()
+{
+    static const CommandFrames frames =
+    {
+        Json::GetCommandFrame(PIPE_COMMAND_ACTIVATED),
+        Json::GetCommandFrame(PIPE_COMMAND_CHECK_WINDOW_DPI),
+        Json::GetCommandFrame(PIPE_COMMAND_CHECK_WINDOW_SIZE),
+        Json::GetCommandFrame(PIPE_COMMAND_CLOSED),
+        Json::GetCommandFrame(PIPE_COMMAND_DEACTIVATED),
+        Json::GetCommandFrame(PIPE_COMMAND_DETACH),
+        Json::GetCommandFrame(PIPE_COMMAND_GET_STATE),
+    };
+
+    return frames;
+}
+
 ConsoleProcess::ConsoleProcess(App& app)
     : app(app.shared_from_this())
     , disposeEvent(::CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS))
     , messageEvent(::CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS))
     , hostWnd(nullptr)
     , processId(0)
+    , processEnvVersion(0)
 {
     this->app->OnProcessCreated(this);
 }
@@ -91,7 +149,7 @@ void ConsoleProcess::Detach()
     {
         this->SetChildWindow(nullptr, this->GetProcessId());
         ::InterlockedExchange(&this->processId, 0);
-        this->SendMessageAsync(PIPE_COMMAND_DETACH);
+        this->SendMessageAsync(::GetCommandFrames().detach);
     }
 
     this->Dispose();
@@ -117,15 +175,26 @@ bool ConsoleProcess::Attach(HANDLE process)
     return false;
 }
 
-bool ConsoleProcess::Start(const Json::Dict& info)
+bool ConsoleProcess::Start(std::wstring&& state)
 {
     assert(App::IsMainThread());
 
     std::shared_ptr<ConsoleProcess> self = shared_from_this();
 
-    this->backgroundThread = std::thread([self, info]()
+    this->backgroundThread = std::thread([self, state = std::move(state)]()
     {
-        self->BackgroundStart(info);
+        // Only the launch values get built, the rest of the saved state is skipped
+        LaunchInfo info{};
+        Json::Reader reader(state.c_str(), state.size());
+
+        if (Json::Read(reader, info))
+        {
+            self->BackgroundStart(info);
+        }
+        else
+        {
+            self->PostDispose();
+        }
     });
 
     return true;
@@ -162,7 +231,7 @@ std::wstring ConsoleProcess::GetProcessState()
     assert(App::IsMainThread());
 
     Json::Dict output;
-    if (this->TransactMessage(PIPE_COMMAND_GET_STATE, output))
+    if (this->TransactMessage(::GetCommandFrames().getState, output))
     {
         return Json::Write(output);
     }
@@ -174,7 +243,7 @@ void ConsoleProcess::SendDpiChanged()
 {
     assert(App::IsMainThread());
 
-    this->SendMessageAsync(PIPE_COMMAND_CHECK_WINDOW_DPI);
+    this->SendMessageAsync(::GetCommandFrames().checkWindowDpi);
 }
 
 void ConsoleProcess::SendSystemCommand(UINT id)
@@ -204,7 +273,7 @@ void ConsoleProcess::Activate()
         ::ShowWindow(this->hostWnd, SW_SHOW);
     }
 
-    this->SendMessageAsync(PIPE_COMMAND_ACTIVATED);
+    this->SendMessageAsync(::GetCommandFrames().activated);
 }
 
 void ConsoleProcess::Deactivate()
@@ -216,7 +285,7 @@ void ConsoleProcess::Deactivate()
         ::ShowWindow(this->hostWnd, SW_HIDE);
     }
 
-    this->SendMessageAsync(PIPE_COMMAND_DEACTIVATED);
+    this->SendMessageAsync(::GetCommandFrames().deactivated);
 }
 
 bool ConsoleProcess::IsActive()
@@ -256,7 +325,7 @@ void ConsoleProcess::SetChildWindow(HWND hwnd, DWORD processId)
             if (::GetDpiForWindow(hwnd) != oldDpi)
             {
                 // Update DPI before the window is visible
-                this->TransactMessage(PIPE_COMMAND_CHECK_WINDOW_DPI);
+                this->TransactMessage(::GetCommandFrames().checkWindowDpi);
             }
 
             RECT rect;
@@ -269,8 +338,8 @@ void ConsoleProcess::SetChildWindow(HWND hwnd, DWORD processId)
             }
 
             // Now's the chance to ask the process for a bunch of info
-            this->SendMessageAsync(PIPE_COMMAND_GET_STATE);
-            this->SendMessageAsync(PIPE_COMMAND_CHECK_WINDOW_SIZE);
+            this->SendMessageAsync(::GetCommandFrames().getState);
+            this->SendMessageAsync(::GetCommandFrames().checkWindowSize);
             this->InjectConhost(hwnd);
         }
         else if (!hwnd && childHwnd)
@@ -302,7 +371,7 @@ LRESULT ConsoleProcess::WindowProc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp
     switch (message)
     {
     case WM_SIZE:
-        this->SendMessageAsync(PIPE_COMMAND_CHECK_WINDOW_SIZE);
+        this->SendMessageAsync(::GetCommandFrames().checkWindowSize);
         break;
 
     case WM_SETFOCUS:
@@ -312,7 +381,7 @@ LRESULT ConsoleProcess::WindowProc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp
     case WM_DESTROY:
         this->app->OnProcessClosing(this);
         this->SendSystemCommand(SC_CLOSE);
-        this->SendMessageAsync(PIPE_COMMAND_CLOSED);
+        this->SendMessageAsync(::GetCommandFrames().closed);
         this->hostWnd = nullptr;
         break;
 
@@ -364,7 +433,7 @@ void ConsoleProcess::InjectConhost(HWND conhostHwnd)
 
 // Creates a pipe server to listen to the other process, and injects a thread
 // into that process to create another pipe server that listens to this process. Whew...
-void ConsoleProcess::BackgroundAttach(HANDLE process, HANDLE mainThread, const Json::Dict* info)
+void ConsoleProcess::BackgroundAttach(HANDLE process, HANDLE mainThread, const LaunchInfo* info)
 {
     assert(!App::IsMainThread());
     std::shared_ptr<ConsoleProcess> self = shared_from_this();
@@ -377,6 +446,9 @@ void ConsoleProcess::BackgroundAttach(HANDLE process, HANDLE mainThread, const J
     Pipe pipe = Pipe::Create(process, this->disposeEvent);
     bool injected = DevInject::InjectDll(process, this->disposeEvent, true);
 
+    // State changes go to HandleNewState, which only looks at a few values
+    pipe.SetLazyParsing(true);
+
     if (injected)
     {
         if (mainThread)
@@ -463,27 +535,19 @@ static bool DirectoryExists(const wchar_t* path)
     return false;
 }
 
-void ConsoleProcess::BackgroundStart(const Json::Dict& info)
+void ConsoleProcess::BackgroundStart(const LaunchInfo& launchInfo)
 {
     assert(!App::IsMainThread());
 
-    std::wstring environment;
-    std::wstring executable = info.Get(PIPE_PROPERTY_EXECUTABLE).TryGetString();
-    std::wstring arguments = info.Get(PIPE_PROPERTY_ARGUMENTS).TryGetString();
-    std::wstring directory = info.Get(PIPE_PROPERTY_DIRECTORY).TryGetString();
-
-    if (info.Get(PIPE_PROPERTY_ENVIRONMENT).IsDict())
-    {
-        environment = Json::WriteNameValuePairs(info.Get(PIPE_PROPERTY_ENVIRONMENT).GetDict(), L'\0');
-    }
+    std::wstring environment = Json::WriteNameValuePairs(launchInfo.environment, L'\0');
 
     std::wstringstream commandLine;
-    commandLine << L"\"" << executable << L"\" " << arguments;
+    commandLine << L"\"" << launchInfo.executable << L"\" " << launchInfo.arguments;
     std::wstring commandLineString = commandLine.str();
     wchar_t* commandLineBuffer = const_cast<wchar_t*>(commandLineString.c_str());
     void* envBlock = const_cast<wchar_t*>(environment.size() > 1 ? environment.c_str() : nullptr);
 
-    const wchar_t* startingDirectory = directory.size() ? directory.c_str() : nullptr;
+    const wchar_t* startingDirectory = launchInfo.directory.size() ? launchInfo.directory.c_str() : nullptr;
     if (startingDirectory && !::DirectoryExists(startingDirectory))
     {
         startingDirectory = nullptr;
@@ -504,7 +568,7 @@ void ConsoleProcess::BackgroundStart(const Json::Dict& info)
 
     if (::CreateProcess(nullptr, commandLineBuffer, &processSecurity, nullptr, FALSE, flags, envBlock, startingDirectory, &si, &pi))
     {
-        this->BackgroundAttach(pi.hProcess, pi.hThread, &info);
+        this->BackgroundAttach(pi.hProcess, pi.hThread, &launchInfo);
     }
     else
     {
@@ -518,9 +582,11 @@ void ConsoleProcess::BackgroundClone(const std::shared_ptr<ConsoleProcess>& proc
     assert(!App::IsMainThread());
 
     Json::Dict output;
-    if (process->TransactMessage(PIPE_COMMAND_GET_STATE, output))
+    if (process->TransactMessage(::GetCommandFrames().getState, output))
     {
-        this->BackgroundStart(output);
+        LaunchInfo info{};
+        Json::Read(output, info);
+        this->BackgroundStart(info);
     }
     else
     {
@@ -534,7 +600,7 @@ void ConsoleProcess::BackgroundSendCommands(HANDLE process)
     std::array<HANDLE, 3> handles = { this->messageEvent, this->disposeEvent, process };
     while (::WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE) == WAIT_OBJECT_0)
     {
-        std::vector<Json::Dict> messages;
+        std::vector<QueuedMessage> messages;
         {
             std::scoped_lock<std::mutex> pipeLock(this->processPipeMutex);
             std::scoped_lock<std::mutex> lock(this->messageMutex);
@@ -601,28 +667,33 @@ void ConsoleProcess::BackgroundInjectConhost(HWND conhostHwnd)
 }
 
 // Initialize a newly created process after pipes are connected
-void ConsoleProcess::InitNewProcess(const Json::Dict& info)
+void ConsoleProcess::InitNewProcess(const LaunchInfo& info)
 {
-    Json::Dict infoCopy = info;
+    // The other values are only useful when first creating the process
+    Json::Dict state;
+    state.Set(Json::Keys::Aliases, Json::Value(info.aliases));
+    state.Set(Json::Keys::Title, Json::Value(info.title));
 
-    // These values are only useful when first creating the process
-    infoCopy.Set(PIPE_PROPERTY_ARGUMENTS, Json::Value());
-    infoCopy.Set(PIPE_PROPERTY_ENVIRONMENT, Json::Value());
-    infoCopy.Set(PIPE_PROPERTY_EXECUTABLE, Json::Value());
-    infoCopy.Set(PIPE_PROPERTY_DIRECTORY, Json::Value());
+    if (info.colors.IsSet())
+    {
+        state.Set(Json::Keys::Colors, Json::Value(Json::ToDict(info.colors)));
+    }
 
-    if (infoCopy.Size())
+    if (state.Size())
     {
-        infoCopy.Set(PIPE_PROPERTY_COMMAND, Json::Value(PIPE_COMMAND_SET_STATE));
-        this->SendMessageAsync(std::move(infoCopy));
+        state.Set(Json::Keys::Command, Json::Value(PIPE_COMMAND_SET_STATE));
+        this->SendMessageAsync(std::move(state));
     }
 }
 
-void ConsoleProcess::SendMessageAsync(std::wstring&& name)
+// Commands without properties are queued as their frame, which gets sent instead of writing the message again
+void ConsoleProcess::SendMessageAsync(const Json::Frame& frame)
 {
-    Json::Dict message;
-    message.Set(PIPE_PROPERTY_COMMAND, Json::Value(std::move(name)));
-    this->SendMessageAsync(std::move(message));
+    // call from any thread
+
+    std::scoped_lock<std::mutex> lock(this->messageMutex);
+    this->messages.push_back(QueuedMessage{ &frame, Json::Dict() });
+    ::SetEvent(this->messageEvent);
 }
 
 // Adds a command to the queue to send to the other process. It may never be sent if the other process dies.
@@ -631,48 +702,55 @@ void ConsoleProcess::SendMessageAsync(Json::Dict&& command)
     // call from any thread
 
     std::scoped_lock<std::mutex> lock(this->messageMutex);
-    this->messages.push_back(std::move(command));
+    this->messages.push_back(QueuedMessage{ nullptr, std::move(command) });
     ::SetEvent(this->messageEvent);
 }
 
-void ConsoleProcess::SendMessages(HANDLE process, const std::vector<Json::Dict>& messages)
+void ConsoleProcess::SendMessages(HANDLE process, const std::vector<QueuedMessage>& messages)
 {
-    for (const Json::Dict& message : messages)
+    for (const QueuedMessage& message : messages)
     {
         Json::Dict output;
-        bool status = false;
+        if (message.frame)
         {
-            std::scoped_lock<std::mutex> lock(this->processPipeMutex);
-            status = this->processPipe && this->processPipe.Transact(message, output);
+            this->TransactMessage(*message.frame, output);
         }
-
-        if (status)
+        else
         {
-            Json::Value name = message.Get(PIPE_PROPERTY_COMMAND);
-            this->HandleResponse(name.TryGetString(), output);
+            this->TransactMessage(message.message, output);
         }
     }
 }
 
 // Blocks while a command is sent
-bool ConsoleProcess::TransactMessage(std::wstring&& name)
+bool ConsoleProcess::TransactMessage(const Json::Frame& frame)
 {
     Json::Dict output;
-    return this->TransactMessage(std::move(name), output);
+    return this->TransactMessage(frame, output);
 }
 
 // Blocks while a command is sent
-bool ConsoleProcess::TransactMessage(std::wstring&& name, Json::Dict& output)
+bool ConsoleProcess::TransactMessage(const Json::Frame& frame, Json::Dict& output)
 {
-    Json::Dict message;
-    message.Set(PIPE_PROPERTY_COMMAND, Json::Value(std::move(name)));
-    return this->TransactMessage(message, output);
+    bool result = false;
+    {
+        std::scoped_lock<std::mutex> lock(this->processPipeMutex);
+        result = this->processPipe && this->processPipe.Transact(frame, output);
+    }
+
+    if (result)
+    {
+        Json::Value name = frame.GetDict().Get(Json::Keys::Command);
+        this->HandleResponse(name.TryGetString(), output);
+    }
+
+    return result;
 }
 
 // Blocks while a command is sent
 bool ConsoleProcess::TransactMessage(const Json::Dict& input, Json::Dict& output)
 {
-    Json::Value name = input.Get(PIPE_PROPERTY_COMMAND);
+    Json::Value name = input.Get(Json::Keys::Command);
     bool result = false;
     {
         std::scoped_lock<std::mutex> lock(this->processPipeMutex);
@@ -692,7 +770,7 @@ void ConsoleProcess::FlushRemainingMessages(HANDLE process)
 {
     while (true)
     {
-        std::vector<Json::Dict> messages;
+        std::vector<QueuedMessage> messages;
         {
             std::scoped_lock<std::mutex> lock(this->messageMutex);
             messages = std::move(this->messages);
@@ -717,11 +795,14 @@ Json::Dict ConsoleProcess::HandleMessage(HANDLE process, const Json::Dict& input
 
     Json::Dict result;
     std::shared_ptr<ConsoleProcess> self = this->shared_from_this();
-    std::wstring name = input.Get(PIPE_PROPERTY_COMMAND).TryGetString();
+    std::wstring name = input.Get(Json::Keys::Command).TryGetString();
 
     if (name == PIPE_COMMAND_PIPE_CREATED)
     {
+        // Stays on UTF-8 JSON, binary messages with environments and aliases are about half again as big.
+        // GetState replies are lazy too, HandleResponse only uses the title and environment.
         Pipe info = Pipe::Connect(process, this->disposeEvent);
+        info.SetLazyParsing(true);
 
         std::scoped_lock<std::mutex> pipeLock(this->processPipeMutex);
         this->processPipe = std::move(info);
@@ -732,7 +813,7 @@ Json::Dict ConsoleProcess::HandleMessage(HANDLE process, const Json::Dict& input
     }
     else if (name == PIPE_COMMAND_WINDOW_CREATED)
     {
-        HWND hwnd = input.Get(PIPE_PROPERTY_HWND).TryGetHwndFromString();
+        HWND hwnd = input.Get(PIPE_PROPERTY_HWND).TryGetHwnd();
         if (hwnd)
         {
             this->app->PostToMainThread([self, hwnd, process]()
@@ -754,11 +835,11 @@ Json::Dict ConsoleProcess::HandleConhostMessage(HANDLE process, HWND conhostHwnd
     assert(!App::IsMainThread());
 
     Json::Dict result;
-    std::wstring name = input.Get(PIPE_PROPERTY_COMMAND).TryGetString();
+    std::wstring name = input.Get(Json::Keys::Command).TryGetString();
 
     if (name == PIPE_COMMAND_CONHOST_INJECTED)
     {
-        result.Set(PIPE_PROPERTY_HWND, Json::Value(std::to_wstring(reinterpret_cast<size_t>(conhostHwnd))));
+        result.Set(PIPE_PROPERTY_HWND, Json::Value(conhostHwnd));
     }
 
     return result;
@@ -778,21 +859,63 @@ void ConsoleProcess::HandleNewState(const Json::Dict& state)
 {
     std::shared_ptr<ConsoleProcess> self = this->shared_from_this();
 
-    Json::Value title = state.Get(PIPE_PROPERTY_TITLE);
-    if (title.IsString())
+    // Nothing posted or stored may point into the message's arena, the pipe reuses it for the next message
+    Json::Value titleValue = state.Get(PIPE_PROPERTY_TITLE);
+    if (titleValue.IsString())
     {
+        std::wstring title = titleValue.TryGetString();
         this->app->PostToMainThread([self, title]()
         {
-            self->app->OnProcessTitleChanged(self.get(), title.GetString());
+            self->app->OnProcessTitleChanged(self.get(), title);
         }, true);
     }
 
-    Json::Value environment = state.Get(PIPE_PROPERTY_ENVIRONMENT);
-    if (environment.IsDict())
+    Json::Value environment = state.Get(Json::Keys::Environment);
+    Json::Value environmentPatch = state.Get(Json::Keys::EnvironmentPatch);
+    Json::Value environmentVersion = state.Get(Json::Keys::EnvironmentVersion);
+    if (environment.IsDict() || environmentPatch.IsDict())
     {
-        this->app->PostToMainThread([self, environment]()
+        // State changes and GetState responses come in on different threads, so they can be out of order
+        int version = environmentVersion.IsInt() ? environmentVersion.GetInt() : 0;
+        Json::Dict processEnv;
+        bool changed = false;
+        bool missedPatch = false;
         {
-            self->app->OnProcessEnvChanged(self.get(), environment.GetDict());
-        }, true);
+            std::scoped_lock<std::mutex> lock(this->processEnvMutex);
+            Json::Dict oldEnv = this->processEnv;
+
+            if (environment.IsDict() && version >= this->processEnvVersion)
+            {
+                this->processEnv = Json::CopyToHeap(environment.GetDict());
+                this->processEnvVersion = version;
+            }
+            else if (environmentPatch.IsDict() && version == this->processEnvVersion + 1)
+            {
+                Json::Apply(this->processEnv, Json::CopyToHeap(environmentPatch.GetDict()));
+                this->processEnvVersion = version;
+            }
+            else if (environmentPatch.IsDict() && version > this->processEnvVersion)
+            {
+                missedPatch = true;
+            }
+
+            // The stored environment keeps its hash, so a full state that didn't change is caught quickly
+            processEnv = this->processEnv;
+            changed = !(processEnv == oldEnv);
+        }
+
+        if (missedPatch)
+        {
+            // The patch doesn't apply to what's here, so get the whole environment again
+            this->SendMessageAsync(::GetCommandFrames().getState);
+        }
+
+        if (changed)
+        {
+            this->app->PostToMainThread([self, processEnv]()
+            {
+                self->app->OnProcessEnvChanged(self.get(), processEnv);
+            }, true);
+        }
     }
 }
@@ -5,6 +5,7 @@
 #include "WindowProc.h"
 
 class App;
+struct LaunchInfo;
 
 class ConsoleProcess : public std::enable_shared_from_this<ConsoleProcess>, public IWindowProc
 {
@@ -17,7 +18,7 @@ public:
     void Detach();
 
     bool Attach(HANDLE process);
-    bool Start(const Json::Dict& info);
+    bool Start(std::wstring&& state);
     bool Clone(const std::shared_ptr<ConsoleProcess>& process);
     HWND GetHostWindow() const;
     DWORD GetProcessId() const;
@@ -38,24 +39,31 @@ private:
     void PostDispose();
     void InjectConhost(HWND conhostHwnd);
 
-    void BackgroundAttach(HANDLE process, HANDLE mainThread = nullptr, const Json::Dict* info = nullptr);
-    void BackgroundStart(const Json::Dict& info);
+    void BackgroundAttach(HANDLE process, HANDLE mainThread = nullptr, const LaunchInfo* info = nullptr);
+    void BackgroundStart(const LaunchInfo& info);
     void BackgroundClone(const std::shared_ptr<ConsoleProcess>& process);
     void BackgroundSendCommands(HANDLE process);
     void BackgroundInjectConhost(HWND conhostHwnd);
-    void InitNewProcess(const Json::Dict& info);
+    void InitNewProcess(const LaunchInfo& info);
 
     Json::Dict HandleMessage(HANDLE process, const Json::Dict& input);
     Json::Dict HandleConhostMessage(HANDLE process, HWND conhostHwnd, const Json::Dict& input);
     void HandleResponse(const std::wstring& name, const Json::Dict& output);
     void HandleNewState(const Json::Dict& state);
 
-    void SendMessageAsync(std::wstring&& name);
+    // Commands without properties are queued as their shared frame, the others as a message
+    struct QueuedMessage
+    {
+        const Json::Frame* frame;
+        Json::Dict message;
+    };
+
+    void SendMessageAsync(const Json::Frame& frame);
     void SendMessageAsync(Json::Dict&& input);
-    bool TransactMessage(std::wstring&& name);
-    bool TransactMessage(std::wstring&& name, Json::Dict& output);
+    bool TransactMessage(const Json::Frame& frame);
+    bool TransactMessage(const Json::Frame& frame, Json::Dict& output);
     bool TransactMessage(const Json::Dict& input, Json::Dict& output);
-    void SendMessages(HANDLE process, const std::vector<Json::Dict>& messages);
+    void SendMessages(HANDLE process, const std::vector<QueuedMessage>& messages);
     void FlushRemainingMessages(HANDLE process);
 
     std::shared_ptr<App> app;
@@ -65,12 +73,17 @@ private:
     HWND hostWnd;
     DWORD processId;
     std::wstring processWindowTitle;
-    std::wstring processEnv;
+
+    // The last environment from the other process, which sends patches after the first one.
+    // Each one has a version, so a late full environment or a patch on the wrong base is caught.
+    std::mutex processEnvMutex;
+    Json::Dict processEnv;
+    int processEnvVersion;
 
     std::mutex processPipeMutex;
     Pipe processPipe;
 
     HANDLE messageEvent;
     std::mutex messageMutex;
-    std::vector<Json::Dict> messages;
+    std::vector<QueuedMessage> messages;
 };
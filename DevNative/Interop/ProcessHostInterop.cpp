@@ -191,8 +191,7 @@ HRESULT ProcessHostInterop::RestoreProcess(const wchar_t* state, IProcess** obj)
     std::shared_ptr<App> app = this->app.lock();
     if (app && this->hwnd)
     {
-        Json::Dict info = Json::Parse(state);
-        HWND hwnd = app->RunProcess(this->hwnd, info);
+        HWND hwnd = app->RunProcess(this->hwnd, std::wstring(state ? state : L""));
         if (hwnd)
         {
             *obj = new ProcessInterop(app.get(), hwnd);
@@ -20,10 +20,15 @@
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
 
 // Defines
 #undef MAX_PATH